@@ -0,0 +1,203 @@
+/*
+ * AMPCACHE.CPP
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#include <ampcache.h>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/stat.h>
+#endif  // _WIN32
+
+// for debugging purpose
+//#define _VERBOSE
+
+/*
+ * 64-bit FNV-1a hash of a string
+*/
+static uint64_t Hash(
+    const string& _s)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < _s.length(); ++i)
+    {
+        hash = (hash ^ static_cast<unsigned char>(_s[i])) * 1099511628211ULL;
+    }
+
+    return(hash);
+}   // end of Hash()
+
+/*
+ * class constructor; the cache is used once Open() has found the directory
+*/
+AmpliconCache::AmpliconCache() :
+    bCached(false)
+{
+    memset(&stHeader, 0, sizeof(stAMPHEADER));
+    pthread_mutex_init(&mtxLock, NULL);
+}   // end of class constructor
+
+AmpliconCache::~AmpliconCache()
+{
+    pthread_mutex_destroy(&mtxLock);
+}   // end of class destructor
+
+/*
+ * find the cache of the primer pair and the database. the file is named after the
+ * database and the hash of the primers and the mismatch settings; it is used only if
+ * it has been built from the same database as it is now, and every outcome in it is an
+ * amplicon or none at all. returns true if the outcomes have been loaded, and false if
+ * there is no cache or it is to be built by this run
+*/
+bool AmpliconCache::Open(
+    CmdParam& _cmd)    // command-line parameters
+{
+    szFile.clear(); vAmplicon.clear(); bCached = false;
+
+#ifdef _WIN32
+    return(false);      // the cache is only supported on posix systems
+#else
+    struct stat info, st; string key, base = _cmd.GetDatabase();
+    char name[32];
+
+    if (!(*_cmd.GetCache()) || !(_cmd.ForwardPrimerCount() > 0) ||
+        !(_cmd.ReversePrimerCount() > 0) || (stat(_cmd.GetDatabase(), &info) < 0))
+    {
+        return(false);
+    }   // the cache is optional, and needs a primer pair and a database
+
+    key = _cmd.GetForwardPrimer(0) + " " + _cmd.GetReversePrimer(0) + " " +
+        to_string(_cmd.Mismatch()) + " " + to_string(_cmd.MaxBase());
+    memcpy(stHeader.magic, szAmpliconMAGIC, sizeof(szAmpliconMAGIC));
+    stHeader.key = Hash(key);
+    stHeader.size = info.st_size; stHeader.inode = info.st_ino;
+    stHeader.mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    stHeader.records = 0;
+
+    base = base.substr(base.find_last_of('/') + 1);
+    sprintf(name, ".%016llx.amp", static_cast<unsigned long long>(stHeader.key));
+    szFile = string(_cmd.GetCache()) + "/" + base + name;
+
+    ifstream ifs(szFile.c_str(), ios::in | ios::binary);
+    stAMPHEADER header;
+
+    if (!ifs.read(reinterpret_cast<char*>(&header), sizeof(stAMPHEADER)) ||
+        memcmp(header.magic, stHeader.magic, sizeof(header.magic)) ||
+        !(header.key == stHeader.key) || !(header.size == stHeader.size) ||
+        !(header.inode == stHeader.inode) || !(header.mtime == stHeader.mtime))
+    {
+#ifdef _VERBOSE
+        cout << "amplicon cache to be built: " << szFile << endl;
+#endif  // _VERBOSE
+        return(false);
+    }   // no cache yet, or it belongs to an older copy of the database
+
+    if ((stat(szFile.c_str(), &st) < 0) ||
+        ((st.st_size - sizeof(stAMPHEADER)) % sizeof(stAMPLICON)) ||
+        !((st.st_size - sizeof(stAMPHEADER)) / sizeof(stAMPLICON) == header.records))
+    {
+        return(false);
+    }   // a truncated cache is built again
+
+    vAmplicon.resize(header.records);
+
+    if (!ifs.read(reinterpret_cast<char*>(vAmplicon.data()), header.records * sizeof(stAMPLICON)))
+    {
+        vAmplicon.clear(); return(false);
+    }   // the cache cannot be read
+
+    for (size_t r = 0; r < vAmplicon.size(); ++r)
+    {
+        const stAMPLICON& a = vAmplicon[r];
+
+        if ((a.begin < 0) ? !((a.begin == -1) && (a.end == -1)) : (a.end < a.begin))
+        {
+            vAmplicon.clear(); return(false);
+        }   // a corrupted cache is built again
+    }   // the end is checked against the sequence in Delimit()
+
+    return(bCached = true);
+#endif  // _WIN32
+}   // end of Open()
+
+/*
+ * keep the outcomes of a batch of records, starting with record _first; nothing is kept
+ * if the cache has been loaded or there is no cache at all
+*/
+void AmpliconCache::Store(
+    size_t                      _first,     // number of the first record of the batch
+    const vector<stAMPLICON>&   _batch)    // outcomes of the records of the batch
+{
+    if (bCached || szFile.empty() || _batch.empty())
+    {
+        return;
+    }   // nothing to build
+
+    pthread_mutex_lock(&mtxLock);
+    // ** enter the critical section for the outcomes
+    if (vAmplicon.size() < _first + _batch.size())
+    {
+        vAmplicon.resize(_first + _batch.size());
+    }   // the batches may arrive out of order
+
+    copy(_batch.begin(), _batch.end(), vAmplicon.begin() + _first);
+    // ** leave the critical section for the outcomes
+    pthread_mutex_unlock(&mtxLock);
+}   // end of Store()
+
+/*
+ * write the cache built by this run; the file is written under a temporary name and
+ * then renamed, so that a concurrent run never reads a partial cache
+*/
+bool AmpliconCache::Close()
+{
+    if (bCached || szFile.empty())
+    {
+        return(true);
+    }   // nothing has been built
+
+#ifdef _WIN32
+    return(true);       // the cache is only supported on posix systems
+#else
+    string temp = szFile + "." + to_string(getpid());
+    ofstream ofs(temp.c_str(), ios::out | ios::binary | ios::trunc);
+
+    stHeader.records = vAmplicon.size();
+    ofs.write(reinterpret_cast<const char*>(&stHeader), sizeof(stAMPHEADER));
+    ofs.write(reinterpret_cast<const char*>(vAmplicon.data()), vAmplicon.size() * sizeof(stAMPLICON));
+    ofs.close();
+
+    if (ofs.fail() || (rename(temp.c_str(), szFile.c_str()) < 0))
+    {
+        unlink(temp.c_str());
+        cout << "cannot write amplicon cache: " << szFile << endl;
+        return(false);
+    }   // the analysis itself is not affected
+
+    return(true);
+#endif  // _WIN32
+}   // end of Close()
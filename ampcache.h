@@ -0,0 +1,154 @@
+/*
+ * AMPCACHE.H
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * this is the header file for the on-disk cache of the amplicons found by a primer pair
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#ifndef _AMPCACHE_H
+#define _AMPCACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <pthread.h>
+
+#include "seqdb.h"
+#include "cmdparam.h"
+#include "bitvector.h"
+#include "seedindex.h"
+
+using namespace std;
+
+const char szAmpliconMAGIC[8] = { 'M', 'I', 'C', 'A', 'A', 'M', 'P', '1' };
+
+/*
+ * outcome of the primer search on a record, as stored in the cache
+*/
+typedef struct
+{
+    int32_t forward, reverse;   // distances of the forward and reverse primers
+    int32_t begin, end;         // first and last base of the amplicon; -1 if none
+} stAMPLICON;
+
+/*
+ * header of the cache file; the outcomes of every record follow in database order
+*/
+typedef struct
+{
+    char magic[8];              // szAmpliconMAGIC
+    uint64_t key;               // hash of the primers and the mismatch settings
+    uint64_t size;              // size of the database in bytes
+    uint64_t inode;             // inode of the database
+    int64_t mtime;              // modification time of the database in nanoseconds
+    uint64_t records;           // number of records that follow
+} stAMPHEADER;
+
+/*
+ * class implementation of the amplicon cache. where the primers bind depends only on the
+ * primer pair, the mismatch settings, and the database, so a run with the same primers
+ * and different enzymes or samples finds the same amplicons. the first run stores the
+ * outcome of the primer search on every record, and the later runs take the amplicons
+ * from the cache and go straight to the digest. the cache is kept in the directory
+ * named by amplicon_cache in the parameter file, one file for each primer pair and
+ * database; a cache is rebuilt whenever the database has changed
+*/
+class   AmpliconCache
+{
+public:
+    AmpliconCache();
+    ~AmpliconCache();
+
+    bool Open(CmdParam&);       // load the cache of the primer pair, or start a new one
+    void Store(size_t, const vector<stAMPLICON>&);  // outcomes of a batch of records
+    bool Close();               // write the new cache
+    bool IsCached() const       { return(bCached); }
+
+    template <class T> bool Delimit(T&, stSEQUENCE&, size_t, vector<stAMPLICON>&, const SeedIndex* = 0);
+
+private:
+    string szFile;              // cache file; empty if there is no cache
+    stAMPHEADER stHeader;       // identifies the primers and the database
+    vector<stAMPLICON> vAmplicon;   // one outcome for each record
+    bool bCached;               // the outcomes have been loaded from the file
+    pthread_mutex_t mtxLock;    // the workers store their batches concurrently
+};  // end of class definition for AmpliconCache
+
+/*
+ * set the sequence and delimit it with the two primers; with a cache, the amplicon is
+ * taken from the cache instead of searched for. otherwise, the outcome is added to
+ * _batch, which the worker stores once the batch is done. with a seed index, the
+ * primers are only tested at the windows that share a seed with them. the class only
+ * needs the same SetStrand(), Delimit(), and SetAmplicon() as the analysis classes
+*/
+template <class T> bool AmpliconCache::Delimit(
+    T&                  _rflp,      // class of the worker
+    stSEQUENCE&         _seq,       // the record
+    size_t              _record,    // number of the record in the database
+    vector<stAMPLICON>& _batch,     // outcomes of the batch, if there is no cache
+    const SeedIndex*    _seeds)    // primer seeds of the database, if indexed
+{
+    stDELIMIT range;
+
+    if (bCached && (_record < vAmplicon.size()) &&
+        (vAmplicon[_record].end < static_cast<int>(_seq.origin.length())))
+    {
+        const stAMPLICON& a = vAmplicon[_record];
+        range.forward = a.forward; range.reverse = a.reverse;
+        range.begin = a.begin; range.end = a.end;
+        range.bForward = range.bReverse = true;
+
+        return(!(a.begin < 0) && _rflp.SetStrand(_seq.origin, &_seq.lanes) &&
+            _rflp.SetAmplicon(range));
+    }   // skip the primer search, unless the amplicon runs past the end of the sequence
+
+    bool found = _rflp.SetStrand(_seq.origin, &_seq.lanes);
+
+    if (found && _seeds && (_seq.lanes.GetLength() == static_cast<int>(_seq.origin.length())) &&
+        _seeds->Delimit(_seq.lanes, _record, range))
+    {
+        found = range.bForward && range.bReverse && _rflp.SetAmplicon(range);
+    }   // look up the windows of the primers instead of searching the whole sequence
+    else
+    {
+        found = found && _rflp.Delimit(range);
+    }   // the record is not in the seed index
+
+    if (!szFile.empty())
+    {
+        stAMPLICON a = { 0, 0, -1, -1 };
+
+        if (found)
+        {
+            a.forward = range.forward; a.reverse = range.reverse;
+            a.begin = range.begin; a.end = range.end;
+        }   // records without an amplicon are stored too, to keep the order
+
+        _batch.push_back(a);
+    }   // the cache is being built
+
+    return(found);
+}   // end of Delimit()
+
+#endif  // _AMPCACHE_H
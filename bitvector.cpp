@@ -28,6 +28,8 @@
  * All rights reserved. Copyright (R) 2005.
  * last updated on April 15, 2005
  * last updated on July 7, 2007
+ * added the precomputed bit lanes on October 18, 2026
+ * extended the bit streams to 128 bases on October 18, 2026
 */
 #include <bitvector.h>
 
@@ -76,15 +78,43 @@ const unsigned int uTarget[nMaxNUCLEOTIDE] =
     0x01d8258a  // thymine  0000:0001:1101:1000:0010:0101:1000:1010
 };
 
+/*
+ * the template patterns of every character, one bit per nucleotide; the character is
+ * folded into the 32 slots of uSource the same way the shift in AddNucleotide() always
+ * did, so that the bit lanes and the rolling bit streams agree on every character
+*/
+struct stSOURCE
+{
+    unsigned char code[256];
+
+    stSOURCE()
+    {
+        int base;
+
+        for (int i = 0; i < 256; ++i)
+        {
+            base = (static_cast<int>(static_cast<char>(i)) - 'A') & (nMaxINT_WIDTH - 1);
+            code[i] = 0;
+
+            for (int j = 0; j < nMaxNUCLEOTIDE; ++j)
+            {
+                code[i] |= ((uSource[j] >> base) & 0x1) << j;
+            }   // collect the bits of the four nucleotides
+        }   // translate every possible character
+    }   // constructor
+};
+
+static const stSOURCE stSource;
+
 /*
  * default constructor; just initialize the variables
 */
 BitVector::BitVector(
     const int _mis, const int _max)
 {
-    uMask = 0;
-    nLeftOffset = nRightOffset = 0;
-    SetMismatch(_mis, _max); Clear();
+    nLength = nLeftOffset = nRightOffset = nOffset = nDistance = 0;
+    SetMask(0); SetMismatch(_mis, _max); Clear();
+    uConserved[0] = uConserved[1] = 0; nConserved = 0;
 }   // end of class constructor
 
 /*
@@ -95,19 +125,22 @@ BitVector& BitVector::operator=(
 {
     if (!(this == &_bv))
     {
-        uStrand[baseA] = _bv.GetAdenine(); uStrand[baseC] = _bv.GetCytosine();
-        uStrand[baseG] = _bv.GetGuanine(); uStrand[baseT] = _bv.GetThymine();
-        uMask = _bv.GetMask(); szStrand = _bv.GetStrand();
-        _bv.GetOffset(nLeftOffset, nRightOffset);
+        memcpy(uStrand, _bv.uStrand, sizeof(uStrand));
+        memcpy(uMask, _bv.uMask, sizeof(uMask));
+        memcpy(uConserved, _bv.uConserved, sizeof(uConserved));
+        szStrand = _bv.szStrand; nLength = _bv.nLength; nWord = _bv.nWord; nMask = _bv.nMask;
+        nLeftOffset = _bv.nLeftOffset; nRightOffset = _bv.nRightOffset; nOffset = _bv.nOffset;
+        nConserved = _bv.nConserved; nExact = _bv.nExact;
+        nMaxBase = _bv.nMaxBase; nDistance = _bv.nDistance;
     }   // make sure don't copy itself
 
     return(*this);
 }   // end of operator overload for =
 
 /*
- * retrieve the bit streams for specified nucleotide
+ * retrieve the first word of the bit streams for specified nucleotide
 */
-unsigned int BitVector::operator[](
+uint64_t BitVector::operator[](
     const int _idx) const
 {
     if (!(_idx < nMaxNUCLEOTIDE))
@@ -115,24 +148,25 @@ unsigned int BitVector::operator[](
         return(0);
     }   // make sure the index is within the range
 
-    return(uStrand[_idx]);
+    return(uStrand[0][_idx]);
 }   // end of operator overload for []
 
 /*
- * overload the 'AND' operator to work on four bitset template variables
+ * overload the 'AND' operator to work on four bitset template variables; only the
+ * first word, i.e. the 64 bases at the 3' end, is combined
 */
-unsigned int BitVector::operator&(
+uint64_t BitVector::operator&(
     const BitVector& _bv) const
 {
-    unsigned int a = 0;
+    uint64_t a = 0;
 
-    a |= (uStrand[baseA] & _bv[baseA]);
-    a |= (uStrand[baseC] & _bv[baseC]);
-    a |= (uStrand[baseG] & _bv[baseG]);
-    a |= (uStrand[baseT] & _bv[baseT]);
+    a |= (uStrand[0][baseA] & _bv[baseA]);
+    a |= (uStrand[0][baseC] & _bv[baseC]);
+    a |= (uStrand[0][baseG] & _bv[baseG]);
+    a |= (uStrand[0][baseT] & _bv[baseT]);
 
 #ifdef _VERBOSE
-    bitset<nMaxINT_WIDTH> bs(a);
+    bitset<nMaxWORD_WIDTH> bs(a);
     cout << "AND operation: " << bs << endl;
 #endif  // _VERBOSE
 
@@ -140,20 +174,21 @@ unsigned int BitVector::operator&(
 }   // end of operator overload for &
 
 /*
- * overload the 'XOR' operator to work on four bitset template variables
+ * overload the 'XOR' operator to work on four bitset template variables; only the
+ * first word, i.e. the 64 bases at the 3' end, is combined
 */
-unsigned int BitVector::operator^(
+uint64_t BitVector::operator^(
     const BitVector& _bv) const
 {
-    unsigned int a = 0;
+    uint64_t a = 0;
 
-    a |= (uStrand[baseA] ^ _bv[baseA]);
-    a |= (uStrand[baseC] ^ _bv[baseC]);
-    a |= (uStrand[baseG] ^ _bv[baseG]);
-    a |= (uStrand[baseT] ^ _bv[baseT]);
+    a |= (uStrand[0][baseA] ^ _bv[baseA]);
+    a |= (uStrand[0][baseC] ^ _bv[baseC]);
+    a |= (uStrand[0][baseG] ^ _bv[baseG]);
+    a |= (uStrand[0][baseT] ^ _bv[baseT]);
 
 #ifdef _VERBOSE
-    bitset<nMaxINT_WIDTH> bs(a);
+    bitset<nMaxWORD_WIDTH> bs(a);
     cout << "XOR operation: " << bs << endl;
 #endif  // _VERBOSE
 
@@ -168,29 +203,20 @@ unsigned int BitVector::operator^(
 int BitVector::SetForwardPrimer(
     const string& _primer)
 {
-    szStrand = _primer; SetContrast();
-    uMask = ~(0xFFFFFFFF << szStrand.length());   // mask to filter unwanted bits
+    szStrand = _primer; nLength = szStrand.length(); SetMask(nLength); SetContrast();
     int base;
 
     for (unsigned int i = 0; i < szStrand.length(); ++i)
     {
         base = static_cast<int>(szStrand[i] - 'A');
-        uStrand[baseA] <<= 0x1; uStrand[baseC] <<= 0x1;     // advance one bit
-        uStrand[baseG] <<= 0x1; uStrand[baseT] <<= 0x1;
 
         // now, "add" a nucleotide into the matrix
-        uStrand[baseA] |= ((uTarget[baseA] >> base) & 0x1);
-        uStrand[baseC] |= ((uTarget[baseC] >> base) & 0x1);
-        uStrand[baseG] |= ((uTarget[baseG] >> base) & 0x1);
-        uStrand[baseT] |= ((uTarget[baseT] >> base) & 0x1);
+        Push(((uTarget[baseA] >> base) & 0x1) << baseA | ((uTarget[baseC] >> base) & 0x1) << baseC |
+            ((uTarget[baseG] >> base) & 0x1) << baseG | ((uTarget[baseT] >> base) & 0x1) << baseT);
     }   // convert characters into binary streams
 
-    // mask out the unwanted bit streams
-    uStrand[baseA] &= uMask; uStrand[baseC] &= uMask;
-    uStrand[baseG] &= uMask; uStrand[baseT] &= uMask;
-
 #ifdef _VERBOSE
-    bitset<nMaxINT_WIDTH> bs(uMask);
+    bitset<nMaxWORD_WIDTH> bs(uMask[0]);
     cout << "   uMask: " << bs << endl;
     cout << "szStrand: " << szStrand << endl;
 #endif  // _VERBOSE
@@ -205,30 +231,21 @@ int BitVector::SetForwardPrimer(
 int BitVector::SetReversePrimer(
     const string& _primer)
 {
-    szStrand = _primer; SetContrast();
-    uMask = ~(0xFFFFFFFF << szStrand.length());   // mask to filter unwanted bits
+    szStrand = _primer; nLength = szStrand.length(); SetMask(nLength); SetContrast();
     int base;
 
     for (unsigned int i = 0; i < szStrand.length(); ++i)
     {
         base = static_cast<int>(szStrand[i] - 'A');
-        uStrand[baseA] <<= 0x1; uStrand[baseC] <<= 0x1;     // advance one bit
-        uStrand[baseG] <<= 0x1; uStrand[baseT] <<= 0x1;
 
         // now, "add" a nucleotide into the matrix
         // NOTE: watch out for the complement, A<->T, C<->G
-        uStrand[baseA] |= ((uTarget[baseT] >> base) & 0x1);
-        uStrand[baseC] |= ((uTarget[baseG] >> base) & 0x1);
-        uStrand[baseG] |= ((uTarget[baseC] >> base) & 0x1);
-        uStrand[baseT] |= ((uTarget[baseA] >> base) & 0x1);
+        Push(((uTarget[baseT] >> base) & 0x1) << baseA | ((uTarget[baseG] >> base) & 0x1) << baseC |
+            ((uTarget[baseC] >> base) & 0x1) << baseG | ((uTarget[baseA] >> base) & 0x1) << baseT);
     }   // convert characters into binary streams
 
-    // mask out the unwanted bit streams
-    uStrand[baseA] &= uMask; uStrand[baseC] &= uMask;
-    uStrand[baseG] &= uMask; uStrand[baseT] &= uMask;
-
 #ifdef _VERBOSE
-    bitset<nMaxINT_WIDTH> bs(uMask);
+    bitset<nMaxWORD_WIDTH> bs(uMask[0]);
     cout << "   uMask: " << bs << endl;
     cout << "szStrand: " << szStrand << endl;
 #endif  // _VERBOSE
@@ -248,7 +265,7 @@ int BitVector::SetEndonuclease(
     const string& _enzyme)
 {
     szStrand.clear();
-    uMask = ~(0xFFFFFFFF << (_enzyme.length() - 1));   // filter unwanted bits
+    SetMask(_enzyme.length() - 1);      // filter unwanted bits
     int base;
     nLeftOffset = 0;    // if not cut symbol '^' is found, the first position is assumed
 
@@ -261,24 +278,17 @@ int BitVector::SetEndonuclease(
 
         szStrand += _enzyme[i];
         base = static_cast<int>(_enzyme[i] - 'A');
-        uStrand[baseA] <<= 0x1; uStrand[baseC] <<= 0x1;     // advance one bit
-        uStrand[baseG] <<= 0x1; uStrand[baseT] <<= 0x1;
 
         // now, "add" a nucleotide into the matrix
-        uStrand[baseA] |= ((uTarget[baseA] >> base) & 0x1);
-        uStrand[baseC] |= ((uTarget[baseC] >> base) & 0x1);
-        uStrand[baseG] |= ((uTarget[baseG] >> base) & 0x1);
-        uStrand[baseT] |= ((uTarget[baseT] >> base) & 0x1);
+        Push(((uTarget[baseA] >> base) & 0x1) << baseA | ((uTarget[baseC] >> base) & 0x1) << baseC |
+            ((uTarget[baseG] >> base) & 0x1) << baseG | ((uTarget[baseT] >> base) & 0x1) << baseT);
     }   // convert characters into binary streams
 
-    // mask out the unwanted bit streams
-    uStrand[baseA] &= uMask; uStrand[baseC] &= uMask;
-    uStrand[baseG] &= uMask; uStrand[baseT] &= uMask;
     // calculate the cut offsets
-    nRightOffset = szStrand.length() - nLeftOffset;
+    nLength = szStrand.length(); nRightOffset = nLength - nLeftOffset;
 
 #ifdef _VERBOSE
-    bitset<nMaxINT_WIDTH> bs(uMask);
+    bitset<nMaxWORD_WIDTH> bs(uMask[0]);
     cout << "   uMask: " << bs << endl;
     cout << "szStrand: " << szStrand << endl;
 #endif  // _VERBOSE
@@ -292,23 +302,23 @@ int BitVector::SetEndonuclease(
 */
 int BitVector::SetForwardStrand(
     int _length,                // length is dictated by the forward primer
-    const string& _strand)     // template sequence
+    string_view _strand)       // template sequence
 {
-    szStrand.clear(); nDistance = _length;
-    uMask = ~(0xFFFFFFFF << _length);     // mask to filter unwanted bits
+    szStrand.clear(); nLength = 0; nDistance = _length;
+    SetMask(_length);           // mask to filter unwanted bits
 
     for (int i = 0; i < _length; ++i)
     {
-        AddNucleotide(_strand[i]);
-    }   // convert characters into binary streams
+        AddNucleotide((i < static_cast<int>(_strand.length())) ? _strand[i] : '\0');
+    }   // convert characters into binary streams; a short template is padded
 
 #ifdef _VERBOSE
-    bitset<nMaxINT_WIDTH> bs(uMask);
+    bitset<nMaxWORD_WIDTH> bs(uMask[0]);
     cout << "   uMask: " << bs << endl;
-    cout << "szStrand: " << szStrand << endl;
+    cout << " nLength: " << nLength << endl;
 #endif  // _VERBOSE
 
-    return(szStrand.length());
+    return(nLength);
 }   // end of SetForwardStrand()
 
 /*
@@ -317,24 +327,24 @@ int BitVector::SetForwardStrand(
 */
 int BitVector::SetReverseStrand(
     int _length,                // length is dictated by the reverse primer
-    const string& _strand)     // template sequence
+    string_view _strand)       // template sequence
 {
-    szStrand.clear(); nDistance = _length;
-    uMask = ~(0xFFFFFFFF << _length);     // mask to filter unwanted bits
+    szStrand.clear(); nLength = 0; nDistance = _length;
+    SetMask(_length);           // mask to filter unwanted bits
     int back = _strand.length();
 
     for (int i = 0; i < _length; ++i)
     {
-        AddNucleotide(_strand[--back]);
+        AddNucleotide((back > 0) ? _strand[--back] : '\0');
     }   // convert characters into binary streams
 
 #ifdef _VERBOSE
-    bitset<nMaxINT_WIDTH> bs(uMask);
+    bitset<nMaxWORD_WIDTH> bs(uMask[0]);
     cout << "   uMask: " << bs << endl;
-    cout << "szStrand: " << szStrand << endl;
+    cout << " nLength: " << nLength << endl;
 #endif  // _VERBOSE
 
-    return(szStrand.length());
+    return(nLength);
 }   // end of SetReverseStrand()
 
 /*
@@ -342,23 +352,23 @@ int BitVector::SetReverseStrand(
 */
 int BitVector::SetDigestStrand(
     int _length,                // length is dictated by the restriction enzyme
-    const string& _strand)     // template sequence
+    string_view _strand)       // template sequence
 {
-    szStrand.clear(); nDistance = 0;
-    uMask = ~(0xFFFFFFFF << _length);     // mask to filter unwanted bits
+    szStrand.clear(); nLength = 0; nDistance = 0;
+    SetMask(_length);           // mask to filter unwanted bits
 
     for (int i = 0; i < _length; ++i)
     {
-        AddNucleotide(_strand[i]);
-    }   // convert characters into binary streams
+        AddNucleotide((i < static_cast<int>(_strand.length())) ? _strand[i] : '\0');
+    }   // convert characters into binary streams; a short template is padded
 
 #ifdef _VERBOSE
-    bitset<nMaxINT_WIDTH> bs(uMask);
+    bitset<nMaxWORD_WIDTH> bs(uMask[0]);
     cout << "   uMask: " << bs << endl;
-    cout << "szStrand: " << szStrand << endl;
+    cout << " nLength: " << nLength << endl;
 #endif  // _VERBOSE
 
-    return(szStrand.length());
+    return(nLength);
 }   // end of SetDigestStrand()
 
 /*
@@ -368,23 +378,56 @@ int BitVector::SetDigestStrand(
 void BitVector::AddNucleotide(
     char _base)                // the nucleotide to be added into the matrix
 {
-    szStrand += _base;
+    unsigned int code = stSource.code[static_cast<unsigned char>(_base)];
+    ++nLength;          // the position is all the scanners need of the bases
+
+    if (nWord == 1)
+    {
+        uStrand[0][baseA] = ((uStrand[0][baseA] << 1) | ((code >> baseA) & 0x1)) & uMask[0];
+        uStrand[0][baseC] = ((uStrand[0][baseC] << 1) | ((code >> baseC) & 0x1)) & uMask[0];
+        uStrand[0][baseG] = ((uStrand[0][baseG] << 1) | ((code >> baseG) & 0x1)) & uMask[0];
+        uStrand[0][baseT] = ((uStrand[0][baseT] << 1) | ((code >> baseT) & 0x1)) & uMask[0];
+        return;
+    }   // the fast path for the short primers and restriction sites
+
+    Push(code);
+}   // end of AddNucleotide()
+
+/*
+ * advance the four bit streams by one base and add the bits of the new base; the bits
+ * of the nucleotides are packed into _code, one bit each. the top bit of each word is
+ * carried into the next one
+*/
+void BitVector::Push(
+    unsigned int _code)        // nucleotides of the new base
+{
+    for (int i = 0; i < nMaxNUCLEOTIDE; ++i)
+    {
+        for (int w = nWord - 1; w > 0; --w)
+        {
+            uStrand[w][i] = ((uStrand[w][i] << 1) | (uStrand[w - 1][i] >> 63)) & uMask[w];
+        }   // carry the top bit of the lower word
 
-    int base = static_cast<int>(_base - 'A');
-    uStrand[baseA] <<= 0x1; uStrand[baseC] <<= 0x1;     // advance one bit
-    uStrand[baseG] <<= 0x1; uStrand[baseT] <<= 0x1;
+        uStrand[0][i] = ((uStrand[0][i] << 1) | ((_code >> i) & 0x1)) & uMask[0];
+    }   // advance one bit across all the words
+}   // end of Push()
 
-    // now, "add" a nucleotide into the matrix
-    // note: N and X are not searched
-    uStrand[baseA] |= ((uSource[baseA] >> base) & 0x1);
-    uStrand[baseC] |= ((uSource[baseC] >> base) & 0x1);
-    uStrand[baseG] |= ((uSource[baseG] >> base) & 0x1);
-    uStrand[baseT] |= ((uSource[baseT] >> base) & 0x1);
+/*
+ * set the mask for a pattern of the given number of bases, and the number of words
+ * needed to hold it
+*/
+void BitVector::SetMask(
+    int _length)               // number of bits in the mask
+{
+    nMask = max(0, min(_length, nMaxPATTERN));
+    nWord = max(1, (nMask + nMaxWORD_WIDTH - 1) / nMaxWORD_WIDTH);
 
-    // mask out the unwanted bit streams
-    uStrand[baseA] &= uMask; uStrand[baseC] &= uMask;
-    uStrand[baseG] &= uMask; uStrand[baseT] &= uMask;
-}   // end of AddNucleotide()
+    for (int w = 0; w < nMaxWORD; ++w)
+    {
+        int bits = min(max(nMask - w * nMaxWORD_WIDTH, 0), nMaxWORD_WIDTH);
+        uMask[w] = (bits < nMaxWORD_WIDTH) ? (static_cast<uint64_t>(1) << bits) - 1 : ~static_cast<uint64_t>(0);
+    }   // the full words first, then the partial word
+}   // end of SetMask()
 
 /*
  * reset the number of mismatches allowed in the search
@@ -416,25 +459,28 @@ void BitVector::GetOffset(
 bool BitVector::IsEnzyme(
     const BitVector& _bv)
 {
-    unsigned int found = 0;
+    uint64_t found;
 
-    // search for the forward match on the restriction enzyme
-    found |= uStrand[baseA] & _bv[baseA];
-    found |= uStrand[baseC] & _bv[baseC];
-    found |= uStrand[baseG] & _bv[baseG];
-    found |= uStrand[baseT] & _bv[baseT];
+    for (int w = 0; w < nWord; ++w)
+    {
+        // search for the forward match on the restriction enzyme
+        found = (uStrand[w][baseA] & _bv.uStrand[w][baseA]) |
+            (uStrand[w][baseC] & _bv.uStrand[w][baseC]) |
+            (uStrand[w][baseG] & _bv.uStrand[w][baseG]) |
+            (uStrand[w][baseT] & _bv.uStrand[w][baseT]);
 
 #ifdef _VERBOSE
-    bitset<32> bs;
-    bs = found; cout << "enzyme match: " << bs << endl; bs.reset();
+        bitset<nMaxWORD_WIDTH> bs;
+        bs = found; cout << "enzyme match: " << bs << endl; bs.reset();
 #endif  // _VERBOSE
 
-    if (found == uMask)
-    {
-        nOffset = nRightOffset; return(true);
-    }   // a match in the forward direction
+        if (!(found == uMask[w]))
+        {
+            return(false);
+        }   // every word must match
+    }   // one word at a time; a single word for the short sites
 
-    return(false);
+    nOffset = nRightOffset; return(true);
 }   // end of IsEnzyme()
 
 /*
@@ -443,25 +489,44 @@ bool BitVector::IsEnzyme(
 bool BitVector::IsPrimer(
     const BitVector& _bv)
 {
-    unsigned int final = (*this & _bv);
+    uint64_t final[nMaxWORD];
     int count = 0;
 
+    if (nWord == 1)
+    {
+        final[0] = (*this & _bv);
+
+        if ((~final[0] & uConserved[0]))
+        {
+            return(false);
+        }   // first, check the conserved regions
+
+        // now, count the matched bits of the mismatched regions
+        return(!(CountBits(final[0] & ~uConserved[0]) < nExact));
+    }   // the fast path for the short primers
+
+    for (int w = 0; w < nWord; ++w)
+    {
+        final[w] = (uStrand[w][baseA] & _bv.uStrand[w][baseA]) |
+            (uStrand[w][baseC] & _bv.uStrand[w][baseC]) |
+            (uStrand[w][baseG] & _bv.uStrand[w][baseG]) |
+            (uStrand[w][baseT] & _bv.uStrand[w][baseT]);
+
 #ifdef _VERBOSE
-    bitset<nMaxINT_WIDTH> bs;
-    bs = final; cout << "final: " << bs << endl;
+        bitset<nMaxWORD_WIDTH> bs;
+        bs = final[w]; cout << "final: " << bs << endl;
 #endif  // _VERBOSE
 
-    if ((~final & uConserved))
-    {
-        return(false);
-    }   // first, check the conserved regions
+        if ((~final[w] & uConserved[w]))
+        {
+            return(false);
+        }   // first, check the conserved regions
+    }   // combine the four nucleotides one word at a time
 
     // now, check the mismatched regions
-    final >>= nConserved;
-
-    for (int i = 0; i < nMaxBase; ++i, final >>= 0x1)
+    for (int w = 0; w < nWord; ++w)
     {
-        count += (final & 0x1);
+        count += CountBits(final[w] & ~uConserved[w]);
     }   // accumulate the number of matched bits
 
     if (count < nExact)
@@ -472,6 +537,299 @@ bool BitVector::IsPrimer(
     return(true);     // otherwise, it should be a match
 }   // end of IsPrimer()
 
+/*
+ * test one bit of the pattern against 64 consecutive windows of the expanded sequence;
+ * bit i of the result is set if the base of the window that starts at _pos + i matches.
+ * in the forward direction the bits run from the 3' end of the window, just like the
+ * rolling bit streams; in the reverse direction they run from the start of the window
+*/
+uint64_t BitVector::Match(
+    const BitLane&  _lane,      // expanded sequence
+    int             _pos,       // start of the first window
+    int             _bit,       // bit of the pattern to test
+    bool            _forward)  // direction of the search
+    const
+{
+    int base = _pos + ((_forward) ? static_cast<int>(szStrand.length()) - 1 - _bit : _bit);
+    uint64_t found = 0;
+
+    for (int i = 0; i < nMaxNUCLEOTIDE; ++i)
+    {
+        if (GetBit(i, _bit))
+        {
+            found |= _lane.GetWindow(i, base);
+        }   // only the nucleotides allowed by the pattern are tested
+    }   // combine the four nucleotides
+
+    return(found);
+}   // end of Match()
+
+/*
+ * count the matched bases of the region where the mismatches are allowed, for the
+ * windows of a block that have passed the conserved region; returns the windows that
+ * satisfy IsPrimer()
+*/
+uint64_t BitVector::Mismatch(
+    const BitLane&  _lane,      // expanded sequence
+    int             _pos,       // start of the first window of the block
+    uint64_t        _found,     // windows that have passed the conserved region
+    bool            _forward)  // direction of the search
+    const
+{
+    uint64_t match[nMaxPATTERN];
+    int count, last = min(nConserved + nMaxBase, nMask);
+
+    if (!_found || !(nExact > 0))
+    {
+        return(_found);
+    }   // nothing to count
+
+    for (int k = max(nConserved, 0); k < last; ++k)
+    {
+        match[k] = Match(_lane, _pos, k, _forward);
+    }   // test the region where the mismatches are allowed
+
+    for (uint64_t bits = _found; bits; bits &= bits - 1)
+    {
+        int i = __builtin_ctzll(bits); count = 0;
+
+        for (int k = max(nConserved, 0); k < last; ++k)
+        {
+            count += (match[k] >> i) & 0x1;
+        }   // accumulate the number of matched bits
+
+        if (count < nExact)
+        {
+            _found &= ~(static_cast<uint64_t>(1) << i);
+        }   // mismatch is less than required
+    }   // check the remaining windows one by one
+
+    return(_found);
+}   // end of Mismatch()
+
+#ifdef _SIMD_X86
+/*
+ * test the conserved region of the primer against 4 consecutive blocks of 64 windows,
+ * the first of which starts at _pos; each 256-bit register holds the same word of the
+ * four blocks, so one shift and one AND test 256 windows at a time
+*/
+__attribute__((target("avx2")))
+void BitVector::Screen4(
+    const BitLane&  _lane,      // expanded sequence
+    int             _pos,       // start of the first window of the first block
+    bool            _forward,   // direction of the search
+    uint64_t*       _found)    // windows of each block that pass the conserved region
+    const
+{
+    __m256i found = _mm256_set1_epi64x(-1), match, word;
+    int base, width = szStrand.length();
+
+    for (int k = 0; k < nConserved; ++k)
+    {
+        base = _pos + ((_forward) ? width - 1 - k : k);
+        __m128i right = _mm_cvtsi32_si128(base & 63), left = _mm_cvtsi32_si128(64 - (base & 63));
+        match = _mm256_setzero_si256();
+
+        for (int i = 0; i < nMaxNUCLEOTIDE; ++i)
+        {
+            if (GetBit(i, k))
+            {
+                const uint64_t* stream = _lane.GetStream(i) + (base >> 6);
+                word = _mm256_or_si256(
+                    _mm256_srl_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(stream)), right),
+                    _mm256_sll_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(stream + 1)), left));
+                match = _mm256_or_si256(match, word);
+            }   // only the nucleotides allowed by the primer are tested
+        }   // combine the four nucleotides
+
+        found = _mm256_and_si256(found, match);
+
+        if (_mm256_testz_si256(found, found))
+        {
+            break;
+        }   // none of the windows is left
+    }   // every base of the conserved region must match
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(_found), found);
+}   // end of Screen4()
+
+/*
+ * same as Screen4(), for 8 consecutive blocks of 64 windows held in 512-bit registers
+*/
+__attribute__((target("avx512f")))
+void BitVector::Screen8(
+    const BitLane&  _lane,      // expanded sequence
+    int             _pos,       // start of the first window of the first block
+    bool            _forward,   // direction of the search
+    uint64_t*       _found)    // windows of each block that pass the conserved region
+    const
+{
+    __m512i found = _mm512_set1_epi64(-1), match, word;
+    int base, width = szStrand.length();
+
+    for (int k = 0; k < nConserved; ++k)
+    {
+        base = _pos + ((_forward) ? width - 1 - k : k);
+        __m128i right = _mm_cvtsi32_si128(base & 63), left = _mm_cvtsi32_si128(64 - (base & 63));
+        match = _mm512_setzero_si512();
+
+        for (int i = 0; i < nMaxNUCLEOTIDE; ++i)
+        {
+            if (GetBit(i, k))
+            {
+                const uint64_t* stream = _lane.GetStream(i) + (base >> 6);
+                word = _mm512_or_si512(
+                    _mm512_srl_epi64(_mm512_loadu_si512(stream), right),
+                    _mm512_sll_epi64(_mm512_loadu_si512(stream + 1), left));
+                match = _mm512_or_si512(match, word);
+            }   // only the nucleotides allowed by the primer are tested
+        }   // combine the four nucleotides
+
+        found = _mm512_and_si512(found, match);
+
+        if (!_mm512_test_epi64_mask(found, found))
+        {
+            break;
+        }   // none of the windows is left
+    }   // every base of the conserved region must match
+
+    _mm512_storeu_si512(_found, found);
+}   // end of Screen8()
+#endif  // _SIMD_X86
+
+/*
+ * number of blocks of 64 windows the primer search tests at once; chosen once by the
+ * features of the processor: 8 with AVX-512, 4 with AVX2, and 1 for the scalar search
+*/
+static int GetBlocks()
+{
+#ifdef _SIMD_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return(8);
+    }   // 512-bit registers
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return(4);
+    }   // 256-bit registers
+#endif  // _SIMD_X86
+
+    return(1);
+}   // end of GetBlocks()
+
+static const int nBlocks = GetBlocks();
+
+/*
+ * search the expanded sequence for the primer, 64 windows at a time; the windows start
+ * at _first through _last and are searched in ascending order for the forward primer and
+ * in descending order for the reverse primer. the conserved region is tested for all the
+ * windows at once, and the mismatches are only counted for the few windows that remain.
+ * where the processor has AVX2 or AVX-512, and at least 4 or 8 blocks of windows are
+ * left, the conserved region is tested for all of those blocks at once.
+ * returns the start of the first window that satisfies IsPrimer(), or -1 if none does
+*/
+int BitVector::FindPrimer(
+    const BitLane&  _lane,      // expanded sequence
+    int             _first,     // start of the first window to test
+    int             _last,      // start of the last window to test
+    bool            _forward)  // direction of the search
+    const
+{
+    uint64_t found, block[8];
+    int pos, span;
+
+    for (int n = 0; !(n > _last - _first); )
+    {
+#ifdef _SIMD_X86
+        if ((nBlocks > 1) && !(_last - _first + 1 - n < 64 * nBlocks))
+        {
+            pos = (_forward) ? _first + n : _last - n - 64 * nBlocks + 1;
+
+            if (nBlocks == 8)
+            {
+                Screen8(_lane, pos, _forward, block);
+            }
+            else
+            {
+                Screen4(_lane, pos, _forward, block);
+            }   // test the conserved region of all the blocks
+
+            for (int j = 0; j < nBlocks; ++j)
+            {
+                int b = (_forward) ? j : nBlocks - 1 - j;
+
+                if ((found = Mismatch(_lane, pos + 64 * b, block[b], _forward)))
+                {
+                    return((_forward) ? pos + 64 * b + __builtin_ctzll(found) :
+                        pos + 64 * b + 63 - __builtin_clzll(found));
+                }   // the nearest window in the direction of the search
+            }   // the blocks in the direction of the search
+
+            n += 64 * nBlocks; continue;
+        }   // search several blocks at a time
+#endif  // _SIMD_X86
+
+        pos = (_forward) ? _first + n : max(_first, _last - n - 63);
+        span = (_forward) ? min(64, _last - pos + 1) : _last - n - pos + 1;
+        found = (span < 64) ? (static_cast<uint64_t>(1) << span) - 1 : ~static_cast<uint64_t>(0);
+
+        for (int k = 0; found && (k < nConserved); ++k)
+        {
+            found &= Match(_lane, pos, k, _forward);
+        }   // every base of the conserved region must match
+
+        if ((found = Mismatch(_lane, pos, found, _forward)))
+        {
+            return((_forward) ? pos + __builtin_ctzll(found) : pos + 63 - __builtin_clzll(found));
+        }   // the nearest window in the direction of the search
+
+        n += 64;
+    }   // search 64 windows at a time
+
+    return(-1);
+}   // end of FindPrimer()
+
+/*
+ * search the expanded sequence for the next restriction site between _offset and
+ * _offset + _length, 64 windows at a time. _last is the value returned by the previous
+ * call, or 0 for the first one; the sites never overlap, just as IsEnzyme() followed by
+ * Clear() does. returns the number of bases up to the end of the site, or 0 if there is
+ * no more restriction site
+*/
+int BitVector::FindEnzyme(
+    const BitLane&  _lane,      // expanded sequence
+    int             _offset,    // first base of the region to digest
+    int             _length,    // number of bases in the region
+    int             _last)     // end of the previous restriction site
+{
+    int width = szStrand.length();
+    int high = (nMask > 0) ? nMask - 1 : 0;
+    int first = (_last > 0) ? _last + high - width + 1 : 0;
+    uint64_t found; int span;
+
+    for (int pos = first; !(pos > _length - width); pos += 64)
+    {
+        span = min(64, _length - width - pos + 1);
+        found = (span < 64) ? (static_cast<uint64_t>(1) << span) - 1 : ~static_cast<uint64_t>(0);
+
+        for (int k = 0; found && (k < nMask); ++k)
+        {
+            found &= Match(_lane, _offset + pos, k, true);
+        }   // every base covered by the mask must match
+
+        if (found)
+        {
+            nOffset = nRightOffset;
+            return(pos + __builtin_ctzll(found) + width);
+        }   // a match in the forward direction
+    }   // search 64 windows at a time
+
+    return(0);
+}   // end of FindEnzyme()
+
 /*
  * print out the bit streams for debugging purposes
  * note: I am too lazy to write a function to convert the bit streams into strings
@@ -479,12 +837,21 @@ bool BitVector::IsPrimer(
 */
 void BitVector::Print()
 {
-    bitset<nMaxINT_WIDTH> bs;
+    const char* name[nMaxNUCLEOTIDE] = { "A: ", "C: ", "G: ", "T: " };
+    bitset<nMaxWORD_WIDTH> bs;
     cout << "   " << szStrand << endl;
-    bs.reset(); bs = uStrand[baseA]; cout << "A: " << bs << endl;
-    bs.reset(); bs = uStrand[baseC]; cout << "C: " << bs << endl;
-    bs.reset(); bs = uStrand[baseG]; cout << "G: " << bs << endl;
-    bs.reset(); bs = uStrand[baseT]; cout << "T: " << bs << endl;
+
+    for (int i = 0; i < nMaxNUCLEOTIDE; ++i)
+    {
+        cout << name[i];
+
+        for (int w = nWord - 1; !(w < 0); --w)
+        {
+            bs.reset(); bs = uStrand[w][i]; cout << bs;
+        }   // the most significant word first
+
+        cout << endl;
+    }   // one line for each nucleotide
 }   // end of Print(); debugging function
 
 /*
@@ -493,11 +860,16 @@ void BitVector::Print()
 void BitVector::SetContrast()
 {
     nConserved = szStrand.length() - nMaxBase;
-    uConserved = (0x1 << nConserved) - 1;
+
+    for (int w = 0; w < nMaxWORD; ++w)
+    {
+        int bits = min(max(nConserved - w * nMaxWORD_WIDTH, 0), nMaxWORD_WIDTH);
+        uConserved[w] = (bits < nMaxWORD_WIDTH) ? (static_cast<uint64_t>(1) << bits) - 1 : ~static_cast<uint64_t>(0);
+    }   // the conserved region may span several words
 
 #ifdef _VERBOSE
-    bitset<nMaxINT_WIDTH> bs;
-    bs = uConserved; cout << "nConserved: " << bs << endl;
+    bitset<nMaxWORD_WIDTH> bs;
+    bs = uConserved[0]; cout << "nConserved: " << bs << endl;
 #endif  // _VERBOSE
 }   // end of SetContrast()
 
@@ -506,10 +878,525 @@ void BitVector::SetContrast()
 */
 void BitVector::Clear()
 {
-    uStrand[baseA] = uStrand[baseC] = 0;
-    uStrand[baseG] = uStrand[baseT] = 0;
+    memset(uStrand, 0, sizeof(uStrand));
 }   // end of Clear()
 
+/*
+ * expand the sequence into the bit streams of the four nucleotides; an extra word is
+ * kept at the end, so that a window can always be read with two words
+*/
+int BitLane::Encode(
+    string_view _strand)       // sequence to be expanded
+{
+    uint64_t word[nMaxNUCLEOTIDE]; unsigned int code;
+    nLength = _strand.length(); nStride = (nLength + 63) / 64 + 1;
+    uLane.assign(nStride * nMaxNUCLEOTIDE, 0);
+
+    for (int i = 0; i < nLength; i += 64)
+    {
+        word[baseA] = word[baseC] = word[baseG] = word[baseT] = 0;
+
+        for (int j = min(nLength - i, 64) - 1; !(j < 0); --j)
+        {
+            code = stSource.code[static_cast<unsigned char>(_strand[i + j])];
+            word[baseA] = (word[baseA] << 1) | ((code >> baseA) & 0x1);
+            word[baseC] = (word[baseC] << 1) | ((code >> baseC) & 0x1);
+            word[baseG] = (word[baseG] << 1) | ((code >> baseG) & 0x1);
+            word[baseT] = (word[baseT] << 1) | ((code >> baseT) & 0x1);
+        }   // the last base of the word goes in first
+
+        for (int j = 0; j < nMaxNUCLEOTIDE; ++j)
+        {
+            uLane[j * nStride + (i >> 6)] = word[j];
+        }   // store the word in each of the four streams
+    }   // expand 64 bases at a time
+
+    return(nLength);
+}   // end of Encode()
+
+/*
+ * locate the forward and reverse primers with the same outcome as the interleaved
+ * search of the tools: in step k the forward primer is tested at the window that starts
+ * at k, and the reverse primer at the window that ends k bases before the end, for as
+ * long as the two windows have not met. each primer stops moving one step after it has
+ * been found. the first hits are located independently, and the steps that the search
+ * would have taken are then worked out from them
+*/
+bool BitLane::Delimit(
+    const BitVector&    _fp,    // forward primer
+    const BitVector&    _rp,    // reverse primer
+    stDELIMIT&          _d)    // positions of the primers
+    const
+{
+    int lf = _fp.GetLength(); int lr = _rp.GetLength();
+    int tf, start;
+
+    // the forward index must stay below the reverse index, which starts at nLength - lr
+    tf = _fp.FindPrimer(*this, 0, nLength - lr - lf, true);
+
+    // a reverse hit is only useful if it is reached before the forward search runs into it
+    start = _rp.FindPrimer(*this, max(Bound(nLength, lf, lr, tf), lf), nLength - lr, false);
+
+    return(Pair(nLength, lf, lr, tf, start, _d));
+}   // end of Delimit()
+
+/*
+ * compile a restriction enzyme, as set by BitVector::SetEndonuclease(); every base covered
+ * by the mask is tested, exactly as BitVector::FindEnzyme() does. returns the number of
+ * enzymes in the table, or 0 if the site is too long
+*/
+int BitDigest::AddEnzyme(
+    const BitVector& _enzyme)      // restriction enzyme
+{
+    stENZYME enzyme; int left;
+    int mask = _enzyme.GetMaskWidth();
+
+    if (_enzyme.GetLength() > nMaxPATTERN)
+    {
+        return(0);
+    }   // the bit streams hold at most 128 bases
+
+    enzyme.width = _enzyme.GetLength();
+    enzyme.high = (mask) ? mask - 1 : 0;
+    enzyme.bits = mask;
+    _enzyme.GetOffset(left, enzyme.offset);
+    memset(enzyme.column, 0, sizeof(enzyme.column));
+
+    for (int k = 0; k < enzyme.bits; ++k)
+    {
+        enzyme.column[k] = (enzyme.width - 1 - k) << nMaxNUCLEOTIDE;
+
+        for (int i = 0; i < nMaxNUCLEOTIDE; ++i)
+        {
+            enzyme.column[k] |= _enzyme.GetBit(i, k) << i;
+        }   // one bit for each allowed nucleotide
+    }   // bit k is the k-th base from the 3' end of the site
+
+    vEnzyme.push_back(enzyme); nWidth = max(nWidth, enzyme.width);
+    return(vEnzyme.size());
+}   // end of AddEnzyme()
+
+/*
+ * find the restriction sites of all enzymes between _offset and _offset + _length. the
+ * sites of an enzyme never overlap; each enzyme resumes its search right after its last
+ * site, just like a chain of BitVector::FindEnzyme() calls, so the outcome is the same.
+ * returns the number of enzymes that cut the region
+*/
+int BitDigest::Digest(
+    const BitLane&      _lane,      // expanded sequence
+    int                 _offset,    // first base of the region to digest
+    int                 _length,    // number of bases in the region
+    vector<stDIGEST>&   _site)     // restriction sites of each enzyme
+    const
+{
+    uint64_t window[nMaxPATTERN << nMaxNUCLEOTIDE], found;
+    int first, span, end, cut = 0;
+    stDIGEST none = { 0, 0, 0 };
+
+    _site.assign(vEnzyme.size(), none);
+
+    for (int pos = 0; pos < _length; pos += 64)
+    {
+        Expand(_lane, _offset, _length, pos, window);
+
+        for (unsigned int e = 0; e < vEnzyme.size(); ++e)
+        {
+            const stENZYME& enzyme = vEnzyme[e]; stDIGEST& site = _site[e];
+            first = (site.count > 0) ? site.last + enzyme.offset + enzyme.high - enzyme.width + 1 : 0;
+            span = min(64, _length - enzyme.width - pos + 1);
+
+            if (!(first < pos + span))
+            {
+                continue;
+            }   // no more window to test in this block
+
+            found = (span < 64) ? (static_cast<uint64_t>(1) << span) - 1 : ~static_cast<uint64_t>(0);
+            found &= (first > pos) ? ~static_cast<uint64_t>(0) << (first - pos) : found;
+
+            for (int k = 0; found && (k < enzyme.bits); ++k)
+            {
+                found &= window[enzyme.column[k]];
+            }   // every base covered by the mask must match
+
+            while (found)
+            {
+                end = pos + __builtin_ctzll(found) + enzyme.width;
+                site.first = (site.count > 0) ? site.first : end - enzyme.offset;
+                site.last = end - enzyme.offset; cut += !(site.count++);
+
+                first = end + enzyme.high - enzyme.width + 1;
+                found &= (first - pos < 64) ? ~static_cast<uint64_t>(0) << (first - pos) : 0;
+            }   // the sites never overlap
+        }   // test all enzymes against the same block
+    }   // digest 64 positions at a time
+
+    return(cut);
+}   // end of Digest()
+
+/*
+ * find every restriction site of all enzymes in the whole sequence; unlike Digest(), the
+ * sites that overlap are all kept, since the sites that a digest uses depend on where
+ * the amplicon starts. the sites are given as the first base of the site. returns the
+ * number of sites found
+*/
+int BitDigest::Locate(
+    const BitLane&          _lane,      // expanded sequence
+    vector< vector<int> >&  _site)     // sites of each enzyme, in ascending order
+    const
+{
+    uint64_t window[nMaxPATTERN << nMaxNUCLEOTIDE], found;
+    int length = _lane.GetLength(); int span, count = 0;
+
+    _site.assign(vEnzyme.size(), vector<int>());
+
+    for (int pos = 0; pos < length; pos += 64)
+    {
+        Expand(_lane, 0, length, pos, window);
+
+        for (unsigned int e = 0; e < vEnzyme.size(); ++e)
+        {
+            const stENZYME& enzyme = vEnzyme[e];
+
+            if (!((span = min(64, length - enzyme.width - pos + 1)) > 0))
+            {
+                continue;
+            }   // no more window to test in this block
+
+            found = (span < 64) ? (static_cast<uint64_t>(1) << span) - 1 : ~static_cast<uint64_t>(0);
+
+            for (int k = 0; found && (k < enzyme.bits); ++k)
+            {
+                found &= window[enzyme.column[k]];
+            }   // every base covered by the mask must match
+
+            for (; found; found &= found - 1, ++count)
+            {
+                _site[e].push_back(pos + __builtin_ctzll(found));
+            }   // keep all the sites
+        }   // test all enzymes against the same block
+    }   // search 64 positions at a time
+
+    return(count);
+}   // end of Locate()
+
+/*
+ * read the bit lanes of the block of 64 windows that starts at _pos, once for all the
+ * enzymes; column m of base d holds the windows whose base d is any of the nucleotides
+ * in m, for the ambiguous bases
+*/
+void BitDigest::Expand(
+    const BitLane&  _lane,      // expanded sequence
+    int             _offset,    // first base of the region
+    int             _length,    // number of bases in the region
+    int             _pos,       // first window of the block
+    uint64_t*       _window)   // windows of each base and combination of nucleotides
+    const
+{
+    for (int d = 0; d < nWidth; ++d)
+    {
+        uint64_t* column = &_window[d << nMaxNUCLEOTIDE]; column[0] = 0;
+
+        for (int i = 0; i < nMaxNUCLEOTIDE; ++i)
+        {
+            column[1 << i] = (_pos + d < _length) ? _lane.GetWindow(i, _offset + _pos + d) : 0;
+        }   // the windows beyond the region are never used
+
+        for (int m = 3; m < (1 << nMaxNUCLEOTIDE); ++m)
+        {
+            column[m] = column[m & (m - 1)] | column[m & -m];
+        }   // every combination of nucleotides
+    }   // one column for each base of the longest site
+}   // end of Expand()
+
+/*
+ * expand the first bases of the conserved region of a primer into seeds; the seed holds
+ * one base in every 2 bits, the base nearest the 3' end of the sequence in the lowest
+ * bits. returns the number of seeds, or -1 if the conserved region is too short or too
+ * ambiguous to give a seed
+*/
+int BitPanel::Seed(
+    const BitVector&    _primer,    // forward or reverse primer
+    bool                _forward,   // direction of the primer
+    unsigned int*       _seed)     // nMaxSEED_EXPAND seeds at most
+{
+    int count = 1; _seed[0] = 0;
+
+    if (!((_primer.GetConserved() & 0xFF) == 0xFF))
+    {
+        return(-1);
+    }   // the conserved region is too short to give a seed
+
+    for (int j = 0; (j < nMaxSEED) && (count > 0); ++j)
+    {
+        int bit = (_forward) ? j : nMaxSEED - 1 - j;
+        int next = 0;
+
+        for (int i = 0; i < nMaxNUCLEOTIDE; ++i)
+        {
+            next += _primer.GetBit(i, bit) * count;
+        }   // every allowed nucleotide multiplies the seeds
+
+        if (next > nMaxSEED_EXPAND)
+        {
+            return(-1);
+        }   // too ambiguous to be worth the table
+
+        for (int i = nMaxNUCLEOTIDE - 1, n = next; !(i < 0); --i)
+        {
+            if (!_primer.GetBit(i, bit))
+            {
+                continue;
+            }
+
+            for (int k = count - 1; !(k < 0); --k)
+            {
+                _seed[--n] = _seed[k] | (i << (2 * j));
+            }
+        }   // expand from the back, so that the seeds are not overwritten
+
+        count = next;
+    }   // bit 0 of a forward primer and bit 7 of a reverse primer are the last base
+
+    return(count);
+}   // end of Seed()
+
+/*
+ * add a primer to the panel and expand the first bases of its conserved region into
+ * seeds; returns the index of the primer
+*/
+int BitPanel::AddPrimer(
+    const BitVector& _primer)  // forward or reverse primer
+{
+    int index = vPrimer.size(); vPrimer.push_back(_primer);
+    unsigned int seed[nMaxSEED_EXPAND]; int count;
+
+    if ((count = Seed(_primer, bForward, seed)) < 0)
+    {
+        vOther.push_back(index); return(index);
+    }   // the conserved region is too short or too ambiguous to give a seed
+
+    for (int k = 0; k < count; ++k)
+    {
+        vSeed.push_back(make_pair(seed[k], index));
+    }   // a primer that allows no nucleotide at some base never matches
+
+    return(index);
+}   // end of AddPrimer()
+
+/*
+ * sort the seeds into the table; must be called after the last primer is added. a few
+ * primers are searched faster on their own, 64 windows at a time, than by reading every
+ * seed of the sequence, so the table is only built for a large enough panel
+*/
+void BitPanel::Compile()
+{
+    if (static_cast<int>(vPrimer.size() - vOther.size()) < nMinPANEL)
+    {
+        vOther.clear(); vSeed.clear();
+
+        for (unsigned int k = 0; k < vPrimer.size(); ++k)
+        {
+            vOther.push_back(k);
+        }
+    }   // search every primer on its own
+
+    sort(vSeed.begin(), vSeed.end());
+    vBucket.assign((1 << (2 * nMaxSEED)) + 1, 0); vEntry.clear();
+    uPresent.assign((1 << (2 * nMaxSEED)) / nMaxWORD_WIDTH, 0);
+
+    for (unsigned int k = 0; k < vSeed.size(); ++k)
+    {
+        ++vBucket[vSeed[k].first + 1]; vEntry.push_back(vSeed[k].second);
+        uPresent[vSeed[k].first >> 6] |= static_cast<uint64_t>(1) << (vSeed[k].first & 63);
+    }   // count the primers of each seed
+
+    for (unsigned int s = 1; s < vBucket.size(); ++s)
+    {
+        vBucket[s] += vBucket[s - 1];
+    }   // the primers of seed s are vEntry[vBucket[s]] to vEntry[vBucket[s + 1] - 1]
+
+    for (unsigned int n = 0; n < 256; ++n)
+    {
+        uSpread[n] = 0;
+
+        for (int k = 0; k < nMaxSEED; ++k)
+        {
+            uSpread[n] |= ((n >> k) & 0x1) << (2 * (nMaxSEED - 1 - k));
+        }
+    }   // bit k of a lane, base k of the seed from the 5' end, goes to bit 2 * (7 - k)
+}   // end of Compile()
+
+/*
+ * test the primers of a seed at one position; _pos is the first base of the seed
+*/
+void BitPanel::Probe(
+    const BitLane&  _lane,      // expanded sequence
+    unsigned int    _seed,      // bases of the sequence at the seed
+    int             _pos,       // first base of the seed
+    vector<int>&    _hit,       // hit of each primer
+    int&            _left)     // number of primers yet to be found
+    const
+{
+    int length = _lane.GetLength();
+
+    for (int e = vBucket[_seed]; e < vBucket[_seed + 1]; ++e)
+    {
+        int k = vEntry[e];
+        int w = (bForward) ? _pos + nMaxSEED - vPrimer[k].GetLength() : _pos;
+
+        if (!(_hit[k] < 0) || (w < 0) || (w > length - vPrimer[k].GetLength()))
+        {
+            continue;
+        }   // already found, or the window does not fit the sequence
+
+        if (!(vPrimer[k].FindPrimer(_lane, w, w, bForward) < 0))
+        {
+            _hit[k] = w; --_left;
+        }   // test the whole primer at this window only
+    }   // every primer sharing the seed
+}   // end of Probe()
+
+/*
+ * test every seed that an ambiguous stretch of the sequence may stand for; an ambiguous
+ * template base matches any of its nucleotides, so only those bases are expanded
+*/
+void BitPanel::Expand(
+    const BitLane&  _lane,      // expanded sequence
+    int             _pos,       // first base of the seed
+    unsigned int    _seed,      // seed, with any code at the ambiguous bases
+    unsigned int    _ambiguous, // bit k is set if base k of the seed is ambiguous
+    vector<int>&    _hit,       // hit of each primer
+    int&            _left)     // number of primers yet to be found
+    const
+{
+    unsigned int seed[nMaxSEED_EXPAND]; int count = 1; seed[0] = _seed;
+
+    for (unsigned int a = _ambiguous; a; a &= a - 1)
+    {
+        int k = __builtin_ctz(a), j = nMaxSEED - 1 - k, base = _pos + k;
+        unsigned int allowed = 0;
+
+        for (int i = 0; i < nMaxNUCLEOTIDE; ++i)
+        {
+            allowed |= ((_lane.GetStream(i)[base >> 6] >> (base & 63)) & 0x1) << i;
+        }   // the nucleotides of the template base
+
+        int next = __builtin_popcount(allowed) * count;
+
+        if (next > nMaxSEED_EXPAND)
+        {
+            for (unsigned int s = 0; s < (1 << (2 * nMaxSEED)); ++s)
+            {
+                Probe(_lane, s, _pos, _hit, _left);
+            }   // far too ambiguous; test every seed
+
+            return;
+        }
+
+        for (int i = nMaxNUCLEOTIDE - 1, n = next; !(i < 0); --i)
+        {
+            if (!((allowed >> i) & 0x1))
+            {
+                continue;
+            }
+
+            for (int c = count - 1; !(c < 0); --c)
+            {
+                seed[--n] = (seed[c] & ~(0x3 << (2 * j))) | (i << (2 * j));
+            }
+        }   // expand from the back, so that the seeds are not overwritten
+
+        count = next;
+    }   // base k from the 5' end is in bits 2 * (7 - k) and 2 * (7 - k) + 1
+
+    for (int c = 0; c < count; ++c)
+    {
+        if ((uPresent[seed[c] >> 6] >> (seed[c] & 63)) & 0x1)
+        {
+            Probe(_lane, seed[c], _pos, _hit, _left);
+        }
+    }
+}   // end of Expand()
+
+/*
+ * find the first window of every forward primer, or the last window of every reverse
+ * primer, just like BitVector::FindPrimer() over the whole sequence; the windows are
+ * visited in the direction of the search, so the first one that passes is the answer.
+ * the bit lanes are read 64 seeds at a time: a seed is usable where none of its 8 bases
+ * is missing, and is put together from the 2-bit codes of its bases with two look ups.
+ * returns the number of primers found
+*/
+int BitPanel::Search(
+    const BitLane&  _lane,      // expanded sequence
+    vector<int>&    _hit)      // hit of each primer; -1 if not found
+    const
+{
+    int length = _lane.GetLength(), seeds = length - nMaxSEED + 1;
+    int blocks = (max(seeds, 0) + 63) >> 6;
+    int left = (vEntry.size() > 0) ? vPrimer.size() - vOther.size() : 0;
+    const uint64_t* stream[nMaxNUCLEOTIDE];
+
+    _hit.assign(vPrimer.size(), -1);
+
+    for (int i = 0; i < nMaxNUCLEOTIDE; ++i)
+    {
+        stream[i] = _lane.GetStream(i);
+    }
+
+    for (int m = 0; (m < blocks) && (left > 0); ++m)
+    {
+        int b = (bForward) ? m : blocks - 1 - m;
+        unsigned __int128 base[nMaxNUCLEOTIDE];
+
+        for (int i = 0; i < nMaxNUCLEOTIDE; ++i)
+        {
+            base[i] = stream[i][b] | (static_cast<unsigned __int128>(stream[i][b + 1]) << 64);
+        }   // the bases of the seeds that start in this block reach into the next word
+
+        unsigned __int128 low = base[baseC] | base[baseT], high = base[baseG] | base[baseT];
+        uint64_t none = Spread(~(base[baseA] | base[baseC] | base[baseG] | base[baseT]));
+        unsigned __int128 ambiguous = (base[baseA] & (base[baseC] | base[baseG] | base[baseT])) |
+            (base[baseC] & (base[baseG] | base[baseT])) | (base[baseG] & base[baseT]);
+        uint64_t many = Spread(ambiguous);
+        uint64_t found = ~none & ((seeds - 64 * b < 64) ?
+            (static_cast<uint64_t>(1) << (seeds - 64 * b)) - 1 : ~static_cast<uint64_t>(0));
+
+        while (found && (left > 0))
+        {
+            int s = (bForward) ? __builtin_ctzll(found) : 63 - __builtin_clzll(found);
+            found &= ~(static_cast<uint64_t>(1) << s);
+
+            unsigned int seed = uSpread[static_cast<unsigned int>(low >> s) & 0xFF] |
+                (uSpread[static_cast<unsigned int>(high >> s) & 0xFF] << 1);
+
+            if ((many >> s) & 0x1)
+            {
+                Expand(_lane, 64 * b + s, seed, static_cast<unsigned int>(ambiguous >> s) & 0xFF,
+                    _hit, left);
+            }   // an ambiguous template base matches any of its nucleotides
+            else if ((uPresent[seed >> 6] >> (seed & 63)) & 0x1)
+            {
+                Probe(_lane, seed, 64 * b + s, _hit, left);
+            }   // most seeds of the sequence belong to no primer at all
+        }   // visit the seeds in the direction of the search
+    }   // 64 seeds at a time
+
+    for (unsigned int k = 0; k < vOther.size(); ++k)
+    {
+        const BitVector& primer = vPrimer[vOther[k]];
+        _hit[vOther[k]] = primer.FindPrimer(_lane, 0, length - primer.GetLength(), bForward);
+    }   // the primers without a seed
+
+    int found = 0;
+
+    for (unsigned int k = 0; k < _hit.size(); ++k)
+    {
+        found += !(_hit[k] < 0);
+    }
+
+    return(found);
+}   // end of Search()
+
 /*
  * test driver program
 */
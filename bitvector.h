@@ -26,26 +26,62 @@
  *
  * All rights reserved. Copyright (R) 2005.
  * last updated on April 15, 2005
+ * added the precomputed bit lanes on October 18, 2026
+ * extended the bit streams to 128 bases on October 18, 2026
+ * counted the mismatches with the population count on October 18, 2026
+ * searched several blocks of windows at once with AVX2/AVX-512 on October 18, 2026
+ * searched a whole panel of primers in one pass on October 18, 2026
 */
 #ifndef _BITVECTOR_H
 #define _BITVECTOR_H
 
 #include <bitset>
+#include <utility>
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <string>
+#include <vector>
+#include <cstdint>
 #include <iostream>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define _SIMD_X86       // the vector kernels are compiled, and chosen at run time
+#endif
 
 using namespace std;
 
 const int nMaxINT_WIDTH     = 8 * sizeof(int);
+const int nMaxWORD_WIDTH    = 8 * sizeof(uint64_t);
+const int nMaxWORD          = 2;        // number of words in each bit stream
+const int nMaxPATTERN       = nMaxWORD * nMaxWORD_WIDTH;
 const int nMaxNUCLEOTIDE    = 4;
 enum { baseA = 0, baseC, baseG, baseT };
 
+class   BitLane;
+
+/*
+ * count the number of bits set in a word; the POPCNT instruction of SSE4.2 is used when
+ * the compiler targets it (-msse4.2, -mpopcnt, or -march=native), and the builtin, which
+ * falls back to a few shifts and adds, otherwise
+*/
+inline int CountBits(uint64_t _word)
+{
+#ifdef __POPCNT__
+    return(static_cast<int>(_mm_popcnt_u64(_word)));
+#else
+    return(__builtin_popcountll(_word));
+#endif  // __POPCNT__
+}   // end of CountBits()
+
 /*
  * class implementation to convert the character sequences into binary stream
- * currently the length of the binary stream is limited to 32 bits. since almost
- * all primers are less than 25 base pairs long, this restriction should not be
- * a problem
+ * each bit stream is held in 64-bit words; the primers and restriction sites of up to
+ * 64 bases fit in a single word and take the fast path, while the longer ones, such as
+ * the probes and the long primers, spill over into the next word. the bit streams hold
+ * up to 128 bases
 */
 class   BitVector
 {
@@ -55,45 +91,248 @@ public:
     ~BitVector() {};
 
     BitVector& operator=(const BitVector&);
-    unsigned int operator&(const BitVector&) const;   // AND two bitvectors
-    unsigned int operator^(const BitVector&) const;   // XOR two bitvectors
-    unsigned int operator[](const int) const;
+    uint64_t operator&(const BitVector&) const;   // AND two bitvectors
+    uint64_t operator^(const BitVector&) const;   // XOR two bitvectors
+    uint64_t operator[](const int) const;
 
     int SetForwardPrimer(const string&);
     int SetReversePrimer(const string&);
     int SetEndonuclease(const string&);
-    int SetForwardStrand(int, const string&);
-    int SetReverseStrand(int, const string&);
-    int SetDigestStrand(int, const string&);
+    int SetForwardStrand(int, string_view);
+    int SetReverseStrand(int, string_view);
+    int SetDigestStrand(int, string_view);
     void AddNucleotide(char);
     void SetMismatch(const int = 0, const int = 0);
     void GetOffset(int&, int&) const;
 
     int GetOffset() const               { return(nOffset); }
-    int GetDistance() const             { return(szStrand.length() - nDistance); }
-    int GetLength() const               { return(szStrand.length()); }
-    unsigned int GetMask() const        { return(uMask); }
-    unsigned int GetConserved() const   { return(uConserved); }
+    int GetDistance() const             { return(nLength - nDistance); }
+    int GetLength() const               { return(nLength); }
+    int GetMaskWidth() const            { return(nMask); }
+    uint64_t GetMask() const            { return(uMask[0]); }
+    uint64_t GetConserved() const       { return(uConserved[0]); }
     const string& GetStrand() const     { return(szStrand); }
 
-    unsigned int GetAdenine() const  { return((*this)[baseA]); }
-    unsigned int GetCytosine() const { return((*this)[baseC]); }
-    unsigned int GetGuanine() const  { return((*this)[baseG]); }
-    unsigned int GetThymine() const  { return((*this)[baseT]); }
+    uint64_t GetAdenine() const  { return((*this)[baseA]); }
+    uint64_t GetCytosine() const { return((*this)[baseC]); }
+    uint64_t GetGuanine() const  { return((*this)[baseG]); }
+    uint64_t GetThymine() const  { return((*this)[baseT]); }
+
+    // bit k of the given nucleotide; bit 0 is the base at the 3' end
+    unsigned int GetBit(int _base, int _bit) const
+        { return((uStrand[_bit >> 6][_base] >> (_bit & 63)) & 0x1); }
 
     bool IsEnzyme(const BitVector&);
     bool IsPrimer(const BitVector&);
+    int FindEnzyme(const BitLane&, int, int, int);
+    int FindPrimer(const BitLane&, int, int, bool) const;
     void Print();       // print out the current bit configurations
     void Clear();       // clear the bit patterns in the class
 
 private:
-    unsigned int uStrand[nMaxNUCLEOTIDE];
-    unsigned int uMask, uConserved;
-    string szStrand;
+    uint64_t uStrand[nMaxWORD][nMaxNUCLEOTIDE];
+    uint64_t uMask[nMaxWORD], uConserved[nMaxWORD];
+    string szStrand;            // the primer or enzyme; not kept for the template strands
+    int nLength;                // number of bases in the bit streams
+    int nWord, nMask;           // words in use and number of bits in the mask
     int nLeftOffset, nRightOffset, nOffset;
     int nConserved, nExact, nMaxBase, nDistance;
 
     void SetContrast();         // calculate the bit patterns for mismatch
+    void SetMask(int);          // mask to filter unwanted bits
+    void Push(unsigned int);    // advance the bit streams by one base
+    uint64_t Match(const BitLane&, int, int, bool) const;
+    uint64_t Mismatch(const BitLane&, int, uint64_t, bool) const;
+    void Screen4(const BitLane&, int, bool, uint64_t*) const;   // AVX2 kernel
+    void Screen8(const BitLane&, int, bool, uint64_t*) const;   // AVX-512 kernel
 };  // end of class definition for BitVector
 
+/*
+ * positions of the primers found by BitLane::Delimit(); the distances are the number of
+ * steps the interleaved search takes to reach each primer
+*/
+typedef struct
+{
+    int forward, reverse;       // distances of the forward and reverse primers
+    int begin, end;             // first and last base between the two primers
+    bool bForward, bReverse;    // whether each primer has been found
+} stDELIMIT;
+
+/*
+ * class implementation to hold an entire sequence expanded into the four bit streams of
+ * A, C, G, and T. bit i of word i/64 of a stream is base i of the sequence, so that a
+ * primer or enzyme can be tested against 64 consecutive positions with a few shifts and
+ * ANDs, instead of rolling the bit streams one nucleotide at a time. the words of each
+ * stream are contiguous, so that the vector kernels load several blocks at once
+*/
+class   BitLane
+{
+public:
+    BitLane() : nLength(0), nStride(0) {};
+    ~BitLane() {};
+
+    int Encode(string_view);    // expand the sequence into the bit streams
+    bool Delimit(const BitVector&, const BitVector&, stDELIMIT&) const;
+    static bool Pair(int, int, int, int, int, stDELIMIT&);  // resolve a pair of primers
+
+    int GetLength() const       { return(nLength); }
+    const uint64_t* GetStream(int _base) const  { return(&uLane[_base * nStride]); }
+
+    /*
+     * retrieve 64 bits of a stream, starting at the given base; bit 0 is that base,
+     * and the bases beyond the end of the sequence are always zero
+    */
+    uint64_t GetWindow(int _base, int _pos) const
+    {
+        const uint64_t* word = &uLane[_base * nStride + (_pos >> 6)];
+        int shift = _pos & 63;
+
+        // the two-step shift keeps the count below 64 when the window is aligned
+        return((word[0] >> shift) | ((word[1] << 1) << (63 - shift)));
+    }   // end of GetWindow()
+
+private:
+    static int Bound(int, int, int, int);   // reach of the reverse search
+
+    vector<uint64_t> uLane;     // the four streams, one after another
+    int nLength;                // number of bases in the sequence
+    int nStride;                // number of words in each stream
+};  // end of class definition for BitLane
+
+/*
+ * lowest start of the reverse window that the interleaved search reaches before the
+ * forward search, which has stopped at _tf or not found the primer at all, runs into it
+*/
+inline int BitLane::Bound(
+    int _length, int _lf, int _lr, int _tf)
+{
+    return((_tf < 0) ? (_length - _lr + _lf - 1) / 2 + 1 : min(_tf + _lf + 1, _length - _lr - _tf));
+}   // end of Bound()
+
+/*
+ * work out the outcome of the interleaved search of one pair of primers from the hits of
+ * each primer searched on its own: _forward is the start of the first window, searched
+ * from the beginning, where the forward primer matches, and _reverse is the start of the
+ * last window where the reverse primer matches; -1 if there is none. the hits do not
+ * depend on the other primer, so a panel of primers is searched once per primer, and
+ * the pairs are then resolved here
+*/
+inline bool BitLane::Pair(
+    int         _length,        // number of bases in the sequence
+    int         _lf,            // length of the forward primer
+    int         _lr,            // length of the reverse primer
+    int         _forward,       // first hit of the forward primer
+    int         _reverse,       // last hit of the reverse primer
+    stDELIMIT&  _d)            // positions of the primers
+{
+    // the first hit within the reach of the forward search is the first hit overall
+    int tf = (_forward > _length - _lr - _lf) ? -1 : _forward;
+
+    // likewise, the last hit of the reverse primer, if the search reaches it at all
+    int start = (_reverse < max(Bound(_length, _lf, _lr, tf), _lf)) ? -1 : _reverse;
+    int tr = (start < 0) ? -1 : _length - _lr - start;
+
+    // the forward index is lf - 1 + min(k, tf + 1) and the reverse index nLength - lr -
+    // min(k, tr + 1) at step k; the search reaches step k while the former is smaller
+    _d.bForward = !(tf < 0) &&
+        (_lf - 1 + tf < _length - _lr - ((tr < 0) ? tf : min(tf, tr + 1)));
+    _d.bReverse = !(tr < 0) &&
+        (_lf - 1 + ((tf < 0) ? tr : min(tr, tf + 1)) < _length - _lr - tr);
+    _d.forward = tf; _d.reverse = tr;
+    _d.begin = tf + _lf; _d.end = start - 1;
+
+    return(_d.bForward && _d.bReverse);
+}   // end of Pair()
+
+/*
+ * restriction sites of one enzyme found by BitDigest::Digest(); the cuts are given as
+ * the number of bases before the cut, counted from the start of the digested region
+*/
+typedef struct
+{
+    int first, last;            // first and last cut of the enzyme
+    int count;                  // number of restriction sites
+} stDIGEST;
+
+/*
+ * class implementation to digest a sequence with a whole list of restriction enzymes in
+ * a single pass. the enzymes are compiled once into a table of the nucleotides allowed
+ * at each base; the bit lanes of every block of 64 positions are then read once and
+ * shared by all enzymes, instead of scanning the sequence again for each enzyme
+*/
+class   BitDigest
+{
+public:
+    BitDigest() : nWidth(0) {};
+    ~BitDigest() {};
+
+    int AddEnzyme(const BitVector&);    // compile a restriction enzyme into the table
+    int Digest(const BitLane&, int, int, vector<stDIGEST>&) const;
+    int Locate(const BitLane&, vector< vector<int> >&) const;  // every site, for the index
+
+    int GetCount() const        { return(vEnzyme.size()); }
+    void Clear()                { vEnzyme.clear(); nWidth = 0; }
+
+private:
+    typedef struct
+    {
+        int width;              // number of bases in the restriction site
+        int bits;               // number of bases tested, counted from the 3' end
+        int high;               // highest bit of the mask; sets the next site that may start
+        int offset;             // number of bases from the cut to the end of the site
+        unsigned short column[nMaxPATTERN];   // window and nucleotides of each base
+    } stENZYME;
+
+    vector<stENZYME> vEnzyme;   // the compiled restriction enzymes
+    int nWidth;                 // longest restriction site
+
+    void Expand(const BitLane&, int, int, int, uint64_t*) const;   // windows of a block
+};  // end of class definition for BitDigest
+
+const int nMaxSEED          = 8;        // number of bases in the seed of a primer
+const int nMaxSEED_EXPAND   = 256;      // most seeds an ambiguous primer may expand into
+const int nMinPANEL         = 48;       // fewest primers worth the table of seeds
+
+/*
+ * class implementation to search a sequence for a whole panel of primers in one pass.
+ * the first 8 bases of the conserved region of every primer, counted from the 3' end,
+ * are expanded into a table of seeds; the sequence is then read once, and a primer is
+ * only tested at the windows whose seed it shares. the primers that are too short or
+ * too ambiguous to give a seed are searched on their own
+*/
+class   BitPanel
+{
+public:
+    BitPanel(const bool _forward = true) : bForward(_forward) {};
+    ~BitPanel() {};
+
+    int AddPrimer(const BitVector&);    // add a primer to the panel
+    static int Seed(const BitVector&, bool, unsigned int*);   // seeds of a primer
+    void Compile();                     // build the table of seeds
+    int Search(const BitLane&, vector<int>&) const;
+
+    int GetCount() const        { return(vPrimer.size()); }
+    const BitVector& operator[](const int _idx) const   { return(vPrimer[_idx]); }
+
+private:
+    bool bForward;              // direction of the primers
+    vector<BitVector> vPrimer;  // the primers, one after another
+    vector<int> vOther;         // primers searched on their own
+    vector<pair<unsigned int, int> > vSeed;    // seed and primer, before compiling
+    vector<int> vBucket;        // first entry of each seed
+    vector<int> vEntry;         // primers of each seed
+    vector<uint64_t> uPresent;  // one bit for every seed that has a primer
+    unsigned short uSpread[256];    // 8 bits of a lane spread over the even bits of a seed
+
+    void Probe(const BitLane&, unsigned int, int, vector<int>&, int&) const;
+    void Expand(const BitLane&, int, unsigned int, unsigned int, vector<int>&, int&) const;
+
+    // the seeds that start at bits 0 to 63 and cover a set base, for the 8 bases of a seed
+    static uint64_t Spread(unsigned __int128 _bits)
+    {
+        _bits |= _bits >> 1; _bits |= _bits >> 2; _bits |= _bits >> 4;
+        return(static_cast<uint64_t>(_bits));
+    }   // end of Spread()
+};  // end of class definition for BitPanel
+
 #endif  // _BITVECTOR_H
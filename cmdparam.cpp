@@ -26,8 +26,10 @@
  *
  * All rights reserved. Copyrights 2004.
  * last updated on June 17, 2004
+ * added the number of threads on October 18, 2026
 */
 #include <cmdparam.h>
+#include <bitvector.h>
 
 // for debugging purpose
 //#define _VERBOSE
@@ -55,7 +57,7 @@ bool CmdParam::OpenFile(
     // initialize some important variables
     nSortOption = nMaxBase = nMismatch = 0;
     nForwardBin = nReverseBin = 0;
-    bOutputAll = true;
+    nThreads = 0; bOutputAll = true;
 
 #ifdef _VERBOSE
     cout << "parameter filename: " << szInFile << endl;
@@ -73,9 +75,33 @@ bool CmdParam::OpenFile(
         return(false);
     }   // make sure the file is in the right format
 
+    if (!CheckPrimer(szForwardPrimer) || !CheckPrimer(szReversePrimer))
+    {
+        return(false);
+    }   // a longer primer would never match
+
     return(true);
 }   // end of OpenFile()
 
+/*
+ * make sure every primer fits into the bit streams, which hold at most nMaxPATTERN bases
+*/
+bool CmdParam::CheckPrimer(
+    const list<string>& _primer)   // forward or reverse primers
+    const
+{
+    for (list<string>::const_iterator i = _primer.begin(); !(i == _primer.end()); ++i)
+    {
+        if ((*i).length() > static_cast<size_t>(nMaxPATTERN))
+        {
+            cout << "fatal: primer is too long: " << (*i) << endl;
+            return(false);
+        }
+    }   // check the primers one by one
+
+    return(true);
+}   // end of CheckPrimer()
+
 /*
  * get the forward primer with given index
 */
@@ -134,6 +160,36 @@ const string& CmdParam::GetEndonuclease(
     return(*i);
 }   // end of GetEndonuclease()
 
+/*
+ * get the forward sample profile with given index; samples are optional, so an
+ * empty name is returned if there is no such sample
+*/
+const char* CmdParam::GetForwardSample(
+    int _idx) const    // which sample?
+{
+    list<string>::const_iterator i;
+
+    for (i = szForwardSample.begin(); !(i == szForwardSample.end()) && (_idx--); ++i)
+        ;
+
+    return((i == szForwardSample.end()) ? "" : (*i).c_str());
+}   // end of GetForwardSample()
+
+/*
+ * get the reverse sample profile with given index; samples are optional, so an
+ * empty name is returned if there is no such sample
+*/
+const char* CmdParam::GetReverseSample(
+    int _idx) const    // which sample?
+{
+    list<string>::const_iterator i;
+
+    for (i = szReverseSample.begin(); !(i == szReverseSample.end()) && (_idx--); ++i)
+        ;
+
+    return((i == szReverseSample.end()) ? "" : (*i).c_str());
+}   // end of GetReverseSample()
+
 /*
  * print the command-line parameters
 */
@@ -162,10 +218,14 @@ void CmdParam::Print()
     cout << "             using database: " << GetDatabase() << endl;
     cout << "at most " << Mismatch() << " mismatches is allowed within the first ";
     cout << MaxBase() << " base pairs" << endl;
-    cout << "   forward sample fragments: " << GetForwardSample() << endl;
-    cout << "   reverse sample fragments: " << GetReverseSample() << endl;
+    cout << "number of forward sample(s): " << ForwardSampleCount() << endl;
+    cout << "number of reverse sample(s): " << ReverseSampleCount() << endl;
     cout << "       forward fragment bin: " << ForwardBin() << endl;
     cout << "       reverse fragment bin: " << ReverseBin() << endl;
+    cout << "          number of threads: " << Threads() << endl;
+    cout << "      amplicon cache folder: " << GetCache() << endl;
+    cout << "     restriction site index: " << GetIndex() << endl;
+    cout << "          primer seed index: " << GetSeedIndex() << endl;
 
     int i;
 
@@ -183,6 +243,16 @@ void CmdParam::Print()
     {
         cout << "endonuclease (" << i << "): " << GetEndonuclease(i) << endl;
     }
+
+    for (i = 0; i < ForwardSampleCount(); ++i)
+    {
+        cout << "forward sample (" << i << "): " << GetForwardSample(i) << endl;
+    }
+
+    for (i = 0; i < ReverseSampleCount(); ++i)
+    {
+        cout << "reverse sample (" << i << "): " << GetReverseSample(i) << endl;
+    }
 }   // end of Print(); debugging function
 
 /*
@@ -253,11 +323,27 @@ bool CmdParam::Parse()
         }
         else if (!(strcmp(token, "forward_sample")))
         {
-            szForwardSample = strtok(0, szParamDELIMIT);
+            szForwardSample.push_back(strtok(0, szParamDELIMIT));
         }
         else if (!(strcmp(token, "reverse_sample")))
         {
-            szReverseSample = strtok(0, szParamDELIMIT);
+            szReverseSample.push_back(strtok(0, szParamDELIMIT));
+        }
+        else if (!(strcmp(token, "threads")))
+        {
+            nThreads = atoi(strtok(0, szParamDELIMIT));
+        }
+        else if (!(strcmp(token, "amplicon_cache")))
+        {
+            szCache = strtok(0, szParamDELIMIT);
+        }
+        else if (!(strcmp(token, "site_index")))
+        {
+            szIndex = strtok(0, szParamDELIMIT);
+        }
+        else if (!(strcmp(token, "seed_index")))
+        {
+            szSeed = strtok(0, szParamDELIMIT);
         }
         else
         {
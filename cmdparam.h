@@ -53,13 +53,16 @@ public:
     const string& GetForwardPrimer(int = 0);
     const string& GetReversePrimer(int = 0);
     const string& GetEndonuclease(int = 0);
-    const list<string>& GetForwardPrimer()  { return(szForwardPrimer); }
-    const list<string>& GetReversePrimer()  { return(szReversePrimer); }
-    const list<string>& GetEndonuclease()   { return(szEndonuclease); }
+    const list<string>& ForwardPrimerList() const  { return(szForwardPrimer); }
+    const list<string>& ReversePrimerList() const  { return(szReversePrimer); }
+    const list<string>& EndonucleaseList() const   { return(szEndonuclease); }
     const char* GetFilename() const { return(szFilename.c_str()); }
     const char* GetDatabase() const { return(szDatabase.c_str()); }
-    const char* GetForwardSample() const { return(szForwardSample.c_str()); }
-    const char* GetReverseSample() const { return(szReverseSample.c_str()); }
+    const char* GetCache() const    { return(szCache.c_str()); }
+    const char* GetIndex() const    { return(szIndex.c_str()); }
+    const char* GetSeedIndex() const    { return(szSeed.c_str()); }
+    const char* GetForwardSample(int = 0) const;
+    const char* GetReverseSample(int = 0) const;
 
     bool OpenFile(const char*);
     bool OutputAll() const          { return(bOutputAll); }
@@ -69,22 +72,31 @@ public:
     int EndonucleaseCount() const   { return(szEndonuclease.size()); }
     int ForwardPrimerCount() const  { return(szForwardPrimer.size()); }
     int ReversePrimerCount() const  { return(szReversePrimer.size()); }
+    int ForwardSampleCount() const  { return(szForwardSample.size()); }
+    int ReverseSampleCount() const  { return(szReverseSample.size()); }
     int SortOption() const          { return(nSortOption); }
     int MaxBase() const             { return(nMaxBase); }
     int Mismatch() const            { return(nMismatch); }
+    int Threads() const             { return(nThreads); }
+    void SetThreads(int _threads)   { nThreads = _threads; }
     void Print();
 
 private:
     list<string> szForwardPrimer, szReversePrimer, szEndonuclease;
     string szFilename, szDatabase;
-    string szForwardSample, szReverseSample;
+    string szCache;         // directory of the amplicon cache; empty for no cache
+    string szIndex;         // restriction site index of the database; empty for none
+    string szSeed;          // primer seed index of the database; empty for none
+    list<string> szForwardSample, szReverseSample;     // one profile per sample
     ifstream ifInFile;
 
     int nSortOption, nMaxBase, nMismatch;
     int nForwardBin, nReverseBin;
+    int nThreads;           // number of worker threads; 0 uses all processors
     bool bOutputAll;
 
     bool Parse();       // parse the command-line parameter
+    bool CheckPrimer(const list<string>&) const;    // make sure the primers are not too long
 };  // end of class definition for CmdParam
 
 #endif  // _PARAM_H
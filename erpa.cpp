@@ -34,14 +34,14 @@
 // support class implementation
 #include "erpa.h"
 #include "pthread.h"
+#include "seqscan.h"
+#include "ampcache.h"
 
 // force PHP to return immediately
 //#define _VERBOSE
 #define CLOSE_PHP       { fclose(stdin); fclose(stdout); fclose(stderr); };
 
-const int nMaxTHREAD    = 4;
 const int nMaxBUFFER    = 8192;
-const int nMaxFRAGMENT  = 2000;
 
 typedef struct
 {
@@ -50,11 +50,13 @@ typedef struct
     string site;            // restriction site
 } stHISTOGRAM;
 
-// define the structure for digest data
+// define the structure for digest data; the fragments are kept as histograms, where
+// element i is the number of fragments that are i bases long
 typedef struct
 {
-    vector<int> forward;    // list of forward fragments
-    vector<int> reverse;    // list of reverse fragments
+    vector<int> forward;    // histogram of forward fragments
+    vector<int> reverse;    // histogram of reverse fragments
+    int count;              // number of sequences amplified by the primers
     double forward_mean;    // average forward fragment sizes
     double forward_stdev;   // standard deviation for forward fragments
     double reverse_mean;    // average reverse fragment sizes
@@ -198,7 +200,7 @@ bool WriteTXT(
     for (list<stRECORD>::iterator i = _lst.begin(); !(i == _lst.end()); ++i)
     {
         sprintf(buffer, "%13s %10d %11d %8d %9.3f %8.3f %8d %9.3f %8.3f",
-            (*i).site.c_str(), static_cast<int>((*i).forward.size()), (*i).success,
+            (*i).site.c_str(), (*i).count, (*i).success,
             (*i).forward_unique, (*i).forward_mean, (*i).forward_stdev,
             (*i).reverse_unique, (*i).reverse_mean, (*i).reverse_stdev);
         ofs << buffer << endl;
@@ -238,7 +240,7 @@ bool WriteCSV(
     for (list<stRECORD>::iterator i = _lst.begin(); !(i == _lst.end()); ++i)
     {
         sprintf(buffer, "\"%s\",%d,%d,%d,%.3f,%.3f,%d,%.3f,%.3f",
-            (*i).site.c_str(), static_cast<int>((*i).forward.size()), (*i).success,
+            (*i).site.c_str(), (*i).count, (*i).success,
             (*i).forward_unique, (*i).forward_mean, (*i).forward_stdev,
             (*i).reverse_unique, (*i).reverse_mean, (*i).reverse_stdev);
         ofs << buffer << endl;
@@ -267,7 +269,7 @@ bool WriteDAT(
     for (list<stRECORD>::iterator i = _lst.begin(); !(i == _lst.end()); ++i)
     {
         sprintf(buffer, "\"%s\",%d,%d,%d,%.3f,%.3f,%d,%.3f,%.3f",
-            (*i).site.c_str(), static_cast<int>((*i).forward.size()), (*i).success,
+            (*i).site.c_str(), (*i).count, (*i).success,
             (*i).forward_unique, (*i).forward_mean, (*i).forward_stdev,
             (*i).reverse_unique, (*i).reverse_mean, (*i).reverse_stdev);
         ofs << buffer << endl;
@@ -303,43 +305,65 @@ bool WritePHP(
 }   // end of WritePHP()
 
 /*
- * calculate the number of unique elements in the vector
+ * add a fragment to the histogram; the histogram grows with the longest fragment, so
+ * there is no limit on the length of the amplicons
 */
-int Unique(
-    vector<int>& _vtr)
+void AddFragment(
+    vector<int>&    _hist,      // histogram of the fragments
+    int             _size)     // length of the fragment
 {
-    vector<bool> element(nMaxFRAGMENT, false);
-    int unique = 0;
+    if (!(_size < static_cast<int>(_hist.size())))
+    {
+        _hist.resize(_size + 1, 0);
+    }   // make room for the longer fragment
+
+    ++_hist[_size];
+}   // end of AddFragment()
 
-    for (unsigned int i = 0; i < _vtr.size(); ++i)
+/*
+ * add the counts of one histogram to another
+*/
+void MergeHistogram(
+    vector<int>&        _to,        // histogram to be updated
+    const vector<int>&  _from)     // histogram to be added
+{
+    if (_to.size() < _from.size())
     {
-        if (!(element[_vtr[i]]))
-        {
-            element[_vtr[i]] = true; ++unique;
-        }
-    }   // iterate through the entire vector
+        _to.resize(_from.size(), 0);
+    }   // make room for the longer fragments
 
-    return(unique);
-}   // end of Unique()
+    for (unsigned int i = 0; i < _from.size(); ++i)
+    {
+        _to[i] += _from[i];
+    }   // add the counts
+}   // end of MergeHistogram()
 
 /*
- * calculate the histogram of the fragments
+ * print out the histograms of the fragments; one line for each fragment length, with
+ * the number of forward and reverse fragments of every restriction enzyme
 */
 bool Histogram(
     list<stRECORD>& _rec)
 {
+    unsigned int length = 0; cout << "\"Length\",";
+
     for (list<stRECORD>::iterator s = _rec.begin(); !(s == _rec.end()); ++s)
     {
         cout << "\"" << (*s).site << "\",,";
-    }   // iterate through the entire list of records and calculate the histogram
+        length = max(length, static_cast<unsigned int>((*s).forward.size()));
+        length = max(length, static_cast<unsigned int>((*s).reverse.size()));
+    }   // iterate through the entire list of records and find the longest fragment
 
     cout << endl;
 
-    for (unsigned int v = 0; v < (_rec.front()).forward.size() ; ++v)
+    for (unsigned int v = 0; v < length; ++v)
     {
+        cout << v << ",";
+
         for (list<stRECORD>::iterator r = _rec.begin(); !(r == _rec.end()); ++r)
         {
-            cout << (*r).forward[v] << "," << (*r).reverse[v] << ",";
+            cout << ((v < (*r).forward.size()) ? (*r).forward[v] : 0) << ",";
+            cout << ((v < (*r).reverse.size()) ? (*r).reverse[v] : 0) << ",";
         }
 
         cout << endl;
@@ -349,140 +373,214 @@ bool Histogram(
 }   // end of Histogram()
 
 /*
- * calculate the mean and standard deviation; this function will calculate the
- * unbiased estimate of the sample variance
+ * calculate the mean, the standard deviation and the number of unique fragment lengths
+ * in one pass over the histogram; the standard deviation is the unbiased estimate of the
+ * sample variance. the sums are kept as integers, so they are exact
 */
 bool Statistics(
-    vector<int>& _vtr,      // vector of numbers
-    double& _mean,          // mean of the numbers
-    double& _stdev)        // unbiased estimate of the sample variance
+    const vector<int>&  _hist,      // histogram of the fragments
+    double&             _mean,      // mean of the fragment lengths
+    double&             _stdev,     // unbiased estimate of the sample variance
+    int&                _unique)   // number of unique fragment lengths
 {
-    if (!(_vtr.size()))
+    uint64_t count = 0, sum = 0, square = 0;
+    _mean = _stdev = 0.0; _unique = 0;
+
+    for (unsigned int i = 0; i < _hist.size(); ++i)
+    {
+        if (_hist[i] > 0)
+        {
+            count += _hist[i]; sum += static_cast<uint64_t>(_hist[i]) * i;
+            square += static_cast<uint64_t>(_hist[i]) * i * i; ++_unique;
+        }   // only the lengths that have been seen
+    }   // accumulate the counts, sums and squares
+
+    if (!(count))
     {
         return(false);
-    }
+    }   // no fragments at all
 
-    _mean = _stdev = 0.0;
+    _mean = static_cast<double>(sum) / count;
+    _stdev = sqrt(static_cast<double>((square - static_cast<long double>(sum) * sum / count) /
+        (count - 1)));  return(true);
+}   // end of Statistics()
 
-    for (unsigned int i = 0; i < _vtr.size(); ++i)
+/*
+ * an enzyme resolving power analysis; everything the analysis needs is kept in the job,
+ * so that several jobs can share a single scan of the database
+*/
+typedef struct
+{
+    CmdParam cmd;                   // parameters of the job
+    AmpliconCache cache;            // amplicons of the primer pair, if cached
+    SiteIndex index;                // restriction sites of the database, if indexed
+    SeedIndex seeds;                // primer seeds of the database, if indexed
+    list<stRECORD> records;         // one record for each restriction enzyme
+    pthread_mutex_t mtxLockITEM;    // critical region lock for records
+} stJOB;
+
+/*
+ * every worker accumulates the cuts and the fragments in its own copy of the records,
+ * which is merged into the job only once, after the database is exhausted
+*/
+typedef struct
+{
+    cERPA* rflp;                    // class of the worker
+    vector<stRECORD> local;         // same order as the records of the job
+} stWORKER;
+
+/*
+ * read the parameter file and set up the job
+*/
+void* OpenJob(
+    const char* _param)    // parameter file
+{
+    stJOB* job = new stJOB; stRECORD item;
+
+    if (!job->cmd.OpenFile(_param))
     {
-        _mean += _vtr[i];
-    }   // first calculate the mean
+        delete job; return(0);
+    }   // open the parameter file; every primer must fit into the bit streams
 
-    _mean /= _vtr.size();
+    job->cache.Open(job->cmd);          // skip the primer search if the amplicons are known
+    job->index.Open(job->cmd);          // look up the restriction sites if they are indexed
 
-    for (unsigned int j = 0; j < _vtr.size(); ++j)
+    if (!job->cache.IsCached())
     {
-        _stdev += pow((_mean - _vtr[j]), 2.0);
-    }   // accumulate the differences
+        job->seeds.Open(job->cmd);
+    }   // look up the windows of the primers if the amplicons are not known
 
-    _stdev = sqrt(_stdev / (_vtr.size() - 1));  return(true);
-}   // end of Statistics()
+    for (unsigned int e = 0; e < job->cmd.EndonucleaseCount(); ++e)
+    {
+        item.forward.clear(); item.reverse.clear();
+        item.forward_mean = item.forward_stdev = 0.0;
+        item.reverse_mean = item.reverse_stdev = 0.0;
+        item.forward_unique = item.reverse_unique = 0;
+        item.count = item.success = 0; item.site = job->cmd.GetEndonuclease(e);
+        job->records.push_back(item);
+    }   // initialize and record the restriction site
 
-// globally accessible classes for multithreading
-CmdParam cmd; SeqDB rdp;
-list<stRECORD> data;
-pthread_mutex_t mtxLockDBMS;    // critical region lock for database
-pthread_mutex_t mtxLockITEM;    // critical region lock for records
+    pthread_mutex_init(&job->mtxLockITEM, NULL);   // initialize the lock for record
+    return(job);
+}   // end of OpenJob()
 
 /*
- * perform the enzyme resolving power analysis
+ * parameters of the job
 */
-void* DoERPA(void*)
+CmdParam& JobParam(
+    void* _job)
 {
-    cERPA rflp(cmd);      // instantiate the class
-    int forward, reverse; bool run = false;
-    int success;
+    return(static_cast<stJOB*>(_job)->cmd);
+}   // end of JobParam()
 
-    do
+/*
+ * set up the class and the local records of a worker
+*/
+void* StartWorker(
+    void* _job)
+{
+    CmdParam& cmd = static_cast<stJOB*>(_job)->cmd;
+    stWORKER* worker = new stWORKER;
+
+    worker->rflp = new cERPA(cmd);      // instantiate the class
+    worker->local.resize(cmd.EndonucleaseCount());
+
+    for (unsigned int e = 0; e < worker->local.size(); ++e)
     {
-        pthread_mutex_lock(&mtxLockDBMS);
-        // ** enter the critical section for database
-        run = rdp.NextRecord();     // retrive a sequence from the database
+        stRECORD& item = worker->local[e];
+        item.count = item.success = 0; item.site = cmd.GetEndonuclease(e);
+    }   // same order as the shared list; only the counters and fragments are used
 
-        if (run)
-        {
-            rflp.SetStrand(rdp.GetOrigin());
-        }   // set the sequence for the search
-        // ** leave the critical section for database
-        pthread_mutex_unlock(&mtxLockDBMS);
+    return(worker);
+}   // end of StartWorker()
+
+/*
+ * perform the enzyme resolving power analysis on a batch of records
+*/
+void ScanBatch(
+    void*       _job,       // the job
+    void*       _worker,    // state of the worker
+    stBATCH*    _batch)    // records to be analyzed
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+    cERPA& rflp = *static_cast<stWORKER*>(_worker)->rflp;
+    vector<stRECORD>& local = static_cast<stWORKER*>(_worker)->local;
+    int forward, reverse;
+
+    vector<stAMPLICON> amplicon;        // outcomes of the primer search, for the cache
 
-        if (!run || !rflp.Delimit())
+    for (int n = 0; n < _batch->count; ++n)
+    {
+        stSEQUENCE& seq = _batch->records[n];
+
+        if (!job.cache.Delimit(rflp, seq, _batch->first + n, amplicon, &job.seeds))
         {
             continue;
-        }   // skip if there is no more sequences or amplification failed
+        }   // skip if amplification failed
+
+        rflp.Digest(&job.index, _batch->first + n);    // cut with all the restriction enzymes at once
 
-        for (list<stRECORD>::iterator k = data.begin(); !(k == data.end()); ++k)
+        for (unsigned int k = 0; k < local.size(); ++k)
         {
             // accumulate the number of successful cuts; true = 1; false = 0
-            success = static_cast<int>(rflp.Digest((*k).site));
-
-            pthread_mutex_lock(&mtxLockITEM);
-            // ** enter the critical section for records
-            (*k).success += success;
-            rflp.GetFragment(forward, reverse);       // get the fragment sizes
-            (*k).forward.push_back(forward);        // store the forward fragment
-            (*k).reverse.push_back(reverse);        // store the reverse fragment
-            // ** leave the critical section for database
-            pthread_mutex_unlock(&mtxLockITEM);
+            local[k].success += static_cast<int>(rflp.GetFragment(k, forward, reverse));
+            ++local[k].count;                       // one more amplified sequence
+            AddFragment(local[k].forward, forward); // count the forward fragment
+            AddFragment(local[k].reverse, reverse); // count the reverse fragment
         }   // iterate through the entire list of restriction enzymes
-    } while (run);
+    }   // process every record of the batch
 
-    return(NULL);
-}   // end of DoERPA()
+    job.cache.Store(_batch->first, amplicon);
+}   // end of ScanBatch()
 
 /*
- * to compile, type:
- * g++ cmdparam.cpp seqdb.cpp bitvector.cpp ispar.cpp -o ispar.exe
+ * merge the results of a worker into the job
 */
-int main(int argc, char** argv)
+void StopWorker(
+    void*   _job,       // the job
+    void*   _worker)   // state of the worker
 {
-    if (argc < 2) {
-        std::cout << "insufficient number of parameters" << std::endl;
-        return(1);
-    }
+    stJOB& job = *static_cast<stJOB*>(_job);
+    stWORKER* worker = static_cast<stWORKER*>(_worker);
+    vector<stRECORD>& local = worker->local;
 
-    cmd.OpenFile(argv[1]);              // open the parameter file
-    rdp.OpenFile(cmd.GetDatabase());      // open the sequence database
-    data.clear(); stRECORD item;
+    pthread_mutex_lock(&job.mtxLockITEM);
+    // ** enter the critical section for records
+    list<stRECORD>::iterator k = job.records.begin();
 
-    for (unsigned int e = 0; e < cmd.EndonucleaseCount(); ++e)
+    for (unsigned int i = 0; i < local.size(); ++i, ++k)
     {
-        item.forward.clear(); item.reverse.clear();
-        item.forward_mean = item.forward_stdev = 0.0;
-        item.reverse_mean = item.reverse_stdev = 0.0;
-        item.forward_unique = item.reverse_unique = 0;
-        item.success = 0; item.site = cmd.GetEndonuclease(e);
-        data.push_back(item);
-    }   // initialize and record the restriction site
+        (*k).count += local[i].count; (*k).success += local[i].success;
+        MergeHistogram((*k).forward, local[i].forward);
+        MergeHistogram((*k).reverse, local[i].reverse);
+    }   // merge the results of this worker
+    // ** leave the critical section for records
+    pthread_mutex_unlock(&job.mtxLockITEM);
 
-    pthread_mutex_init(&mtxLockDBMS, NULL);   // initialize the lock for database
-    pthread_mutex_init(&mtxLockITEM, NULL);   // initialize the lock for record
-    vector<pthread_t> pts(nMaxTHREAD, 0);     // a vector for pthread
+    delete worker->rflp; delete worker;
+}   // end of StopWorker()
 
-    for (unsigned int i = 0; i < pts.size(); ++i)
-    {
-        pthread_create(&pts[i], NULL, &DoERPA, NULL);
-    }   // first, spawn the threads
-
-    for (unsigned int j = 0; j < pts.size(); ++j)
-    {
-        pthread_join(pts[j], NULL);
-    }   // wait for all threads to complete
+/*
+ * calculate the statistics of every restriction enzyme and write the outputs; returns
+ * false if an output cannot be written
+*/
+bool CloseJob(
+    void* _job)
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+    list<stRECORD>& records = job.records;
 
 #ifdef _FRAGMENTS   // output all fragements for the creations of histograms
-    Histogram(data);
+    Histogram(records);
 #endif  // _FRAGMENTS
 
-    for (list<stRECORD>::iterator s = data.begin(); !(s == data.end()); ++s)
+    for (list<stRECORD>::iterator s = records.begin(); !(s == records.end()); ++s)
     {
-        Statistics((*s).forward, (*s).forward_mean, (*s).forward_stdev);
-        Statistics((*s).reverse, (*s).reverse_mean, (*s).reverse_stdev);
-        (*s).forward_unique = Unique((*s).forward);
-        (*s).reverse_unique = Unique((*s).reverse);
+        Statistics((*s).forward, (*s).forward_mean, (*s).forward_stdev, (*s).forward_unique);
+        Statistics((*s).reverse, (*s).reverse_mean, (*s).reverse_stdev, (*s).reverse_unique);
 
 #ifdef _VERBOSE
-        cout << (*s).site << ", " << (*s).success << ", " << (*s).forward.size();
+        cout << (*s).site << ", " << (*s).success << ", " << (*s).count;
         cout << ", " << (*s).forward_mean << ", " << (*s).forward_stdev;
         cout << ", " << (*s).forward_unique << ", " << (*s).reverse_mean;
         cout << ", " << (*s).reverse_stdev << ", " << (*s).reverse_unique << endl;
@@ -500,17 +598,62 @@ int main(int argc, char** argv)
         SortReverseUniqueD      // sort by reverse fragments in descending order
     };  // nasty function pointers
 
-    data.sort(*SortOption[cmd.SortOption()]);     // sort the output data
+    records.sort(*SortOption[job.cmd.SortOption()]);     // sort the output data
 
     /*
      * write the output in various formats; explicitly signal the compiler that these
      * funcation calls do not require any specific order. the compiler is free to
      * rearrange for processor dispatch and parallel processing.
     */
-    WriteTXT(data, cmd), WriteCSV(data, cmd), WriteDAT(data, cmd), WritePHP(data, cmd);
+    bool written = WriteTXT(records, job.cmd) & WriteCSV(records, job.cmd) & WriteDAT(records, job.cmd) &
+        WritePHP(records, job.cmd);
+
+    job.cache.Close();                  // keep the amplicons for the next run
+    job.index.Close();                  // release the site index
+    job.seeds.Close();                  // release the seed index
+    pthread_mutex_destroy(&job.mtxLockITEM);
+    delete &job;
+    return(written);
+}   // end of CloseJob()
+
+// the hooks of the analysis into the database scan
+const stANALYSIS stAnalysis =
+{
+    "erpa", OpenJob, JobParam, StartWorker, ScanBatch, StopWorker, CloseJob
+};
+
+/*
+ * to compile, type:
+ * g++ -std=c++17 -O3 -I. bitvector.cpp cmdparam.cpp seqdb.cpp threadpool.cpp seqqueue.cpp
+ *     seqscan.cpp ampcache.cpp siteindex.cpp seedindex.cpp erpa.cpp -o erpa -lpthread
+*/
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cout << "insufficient number of parameters" << std::endl;
+        return(1);
+    }
+
+    void* job = OpenJob(argv[1]);       // open the parameter file
+
+    if (!job)
+    {
+        return(1);
+    }   // the parameter file cannot be used
+
+    CmdParam& cmd = JobParam(job);
+
+    if (argc > 2)
+    {
+        cmd.SetThreads(atoi(argv[2]));
+    }   // the number of threads on the command line overrides the parameter file
+
+    bool scanned = ScanDatabase(cmd.GetDatabase(), cmd.Threads(), vector<stQUERY>(1, { &stAnalysis, job }));
+
+    if (!CloseJob(job) || !scanned)
+    {
+        return(1);
+    }   // the database cannot be read, or an output cannot be written
 
-    pthread_exit(NULL);
-    pthread_mutex_destroy(&mtxLockITEM);
-    pthread_mutex_destroy(&mtxLockDBMS);
     return(0);
 }   // end of main()
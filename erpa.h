@@ -47,6 +47,7 @@
 #include "seqdb.h"
 #include "cmdparam.h"
 #include "bitvector.h"
+#include "siteindex.h"
 
 // for debugging purpose
 //#define _VERBOSE
@@ -63,29 +64,37 @@ public:
     cERPA(CmdParam&);
     ~cERPA() {};
 
-    bool SetStrand(const string&);
-    bool Delimit();                 // delimit sequences with two primers
-    bool Digest(const string&);   // cut sequences with restriction enzymes
+    bool SetStrand(string_view, const BitLane* = 0);
+    bool Delimit(stDELIMIT&);       // delimit sequences with two primers
+    bool SetAmplicon(const stDELIMIT&); // delimit with an amplicon found before
+    bool Delimit()      { stDELIMIT range; return(Delimit(range)); }
+    int Digest(const SiteIndex* = 0, size_t = 0);   // cut sequences with all the restriction enzymes
 
-    void GetFragment(int& _ff, int& _rf) const
+    bool GetFragment(int _e, int& _ff, int& _rf) const
     {
-        _ff = nForwardFragment; _rf = nReverseFragment;
-    }   // return the forward and reverse fragments
+        _ff = vForwardFragment[_e]; _rf = vReverseFragment[_e]; return(vCut[_e]);
+    }   // return the forward and reverse fragments, and whether the enzyme cuts
 
     void PrintStrand() const    { cout << szStrand; }
 
 private:
     int nForwardIndex, nReverseIndex, nEnzymeIndex;
     int nForwardDistance, nReverseDistance;
-    int nForwardFragment, nReverseFragment;
+    vector<int> vForwardFragment, vReverseFragment;
+    vector<bool> vCut;          // whether each enzyme has cut the amplicon
     bool bForwardFound, bReverseFound;
+    const BitLane* pLane;       // bit lanes of the sequence, or 0 to roll the bit streams
+    int nAmplicon;              // offset of the amplicon in the bit lanes
 
     // binary representations for the primers and restriction enzymes
     BitVector bvForwardPrimer, bvReversePrimer;
     BitVector bvForwardStrand, bvReverseStrand;
-    BitVector bvEndonuclease, bvEnzymeStrand;
+    BitVector bvEnzymeStrand;
+    list<BitVector> bvEndonuclease;
+    BitDigest bdEndonuclease;   // all the restriction enzymes, compiled once
+    vector<stDIGEST> vSite;     // restriction sites of each enzyme
 
-    string szStrand;
+    string_view szStrand;       // view of the record, narrowed to the amplicon
 };  // end of class defintion for cERPA
 
 /*
@@ -96,6 +105,8 @@ private:
 cERPA::cERPA(
     CmdParam& _cmd)    // command-line parameters
 {
+    BitVector enzyme;
+
     // convert the forward and reverse primers into bit streams
     bvForwardPrimer.SetMismatch(_cmd.Mismatch(), _cmd.MaxBase());
     bvReversePrimer.SetMismatch(_cmd.Mismatch(), _cmd.MaxBase());
@@ -106,15 +117,24 @@ cERPA::cERPA(
     cout << "forward primer: " << endl; bvForwardPrimer.Print();
     cout << "reverse primer: " << endl; bvReversePrimer.Print();
 #endif  // _VERBOSE
+
+    // convert the restriction enzymes into bit streams, once for all the sequences
+    for (int i = 0; i < _cmd.EndonucleaseCount(); ++i)
+    {
+        enzyme.SetEndonuclease(_cmd.GetEndonuclease(i));
+        bvEndonuclease.push_back(enzyme); bdEndonuclease.AddEnzyme(enzyme);
+    }
 }   // end of class constructor
 
 /*
  * set the sequence to be searched
 */
 bool cERPA::SetStrand(
-    const string& _s)
+    string_view     _s,         // sequence to be searched
+    const BitLane*  _lane)     // bit lanes of the sequence, if available
 {
-    szStrand = _s;
+    szStrand = _s; nAmplicon = 0;
+    pLane = (_lane && (_lane->GetLength() == static_cast<int>(_s.length()))) ? _lane : 0;
 
     if (!(szStrand.length() > 0))
     {
@@ -125,6 +145,11 @@ bool cERPA::SetStrand(
     cout << "szStrand: " << szStrand << endl;
 #endif
 
+    if (pLane)
+    {
+        return(true);
+    }   // the bit lanes are searched directly
+
     // convert primers and sequence into bit streams for search
     bvForwardStrand.SetForwardStrand(bvForwardPrimer.GetLength(), szStrand);
     bvReverseStrand.SetReverseStrand(bvReversePrimer.GetLength(), szStrand);
@@ -140,13 +165,30 @@ bool cERPA::SetStrand(
 }   // end of SetStrand()
 
 /*
- * restrict the sequences with two primers
+ * restrict the sequences with two primers; the outcome is kept in _range, so that it
+ * can be given to SetAmplicon() later
 */
-bool cERPA::Delimit()
+bool cERPA::Delimit(
+    stDELIMIT& _range)     // positions of the primers and the amplicon
 {
     bForwardFound = bReverseFound = false;
     nForwardDistance = nReverseDistance = 0;
 
+    if (pLane)
+    {
+        bool found = pLane->Delimit(bvForwardPrimer, bvReversePrimer, _range);
+        bForwardFound = _range.bForward; bReverseFound = _range.bReverse;
+
+        if (found)
+        {
+            nForwardDistance = _range.forward; nReverseDistance = _range.reverse;
+            szStrand = szStrand.substr(_range.begin, _range.end - _range.begin + 1);
+            nAmplicon = _range.begin;
+        }   // same outcome as the interleaved search below
+
+        return(found);
+    }   // search the bit lanes of the sequence, 64 positions at a time
+
     while (nForwardIndex < nReverseIndex)
     {
         if (!bForwardFound)
@@ -166,6 +208,10 @@ bool cERPA::Delimit()
             // pointer will one step further even though a match has been found
             nForwardDistance = bvForwardStrand.GetDistance() - 1;
             nReverseDistance = bvReverseStrand.GetDistance() - 1;
+            _range.forward = nForwardDistance; _range.reverse = nReverseDistance;
+            _range.begin = nForwardIndex; _range.end = nReverseIndex;
+            _range.bForward = _range.bReverse = true;
+            nAmplicon = nForwardIndex;
             szStrand = szStrand.substr(nForwardIndex, nReverseIndex - nForwardIndex + 1);
 
 #ifdef _VERBOSE         // print out some crucial variables
@@ -182,51 +228,95 @@ bool cERPA::Delimit()
 }   // end of Delimit()
 
 /*
- * cut the sequence with the restriction enzyme(s)
+ * delimit the sequence with an amplicon that Delimit() has found before, such as one
+ * taken from the amplicon cache; the outcome is the same as that of the search. the
+ * amplicon must lie within the sequence
 */
-bool cERPA::Digest(
-    const string& _enzyme)
+bool cERPA::SetAmplicon(
+    const stDELIMIT& _range)   // positions of the primers and the amplicon
 {
-    int prior, size, full;
+    bForwardFound = _range.bForward; bReverseFound = _range.bReverse;
+    nForwardDistance = _range.forward; nReverseDistance = _range.reverse;
+    szStrand = szStrand.substr(_range.begin, _range.end - _range.begin + 1);
+    nAmplicon = _range.begin;
+    return(true);
+}   // end of SetAmplicon()
+
+/*
+ * cut the sequence with all the restriction enzymes; the sites of every enzyme are
+ * looked up in the site index, or found in a single pass over the bit lanes of the
+ * amplicon. returns the number of enzymes that cut the amplicon
+*/
+int cERPA::Digest(
+    const SiteIndex*    _index,     // restriction sites of the database, if any
+    size_t              _record)   // number of the record in the database
+{
+    int prior, size, full, cut = 0, e = 0;
     vector<int> trf;
     full = bvForwardPrimer.GetLength() + bvReversePrimer.GetLength() + szStrand.length();
-    bvEndonuclease.SetEndonuclease(_enzyme);          // construct the bit patterns
-    nEnzymeIndex = bvEndonuclease.GetLength() - 1;      // index starts from 0
-    bvEnzymeStrand.SetDigestStrand(bvEndonuclease.GetLength(), szStrand);
-    prior = 0;
+    vForwardFragment.assign(bvEndonuclease.size(), full);
+    vReverseFragment.assign(bvEndonuclease.size(), full);
+    vCut.assign(bvEndonuclease.size(), false);
 
-    while (nEnzymeIndex < static_cast<int>(szStrand.length()))
+    bool found = _index && _index->IsOpen() &&
+        _index->Digest(_record, nAmplicon, szStrand.length(), vSite);
+
+    if (!found && pLane)
     {
-        if (bvEndonuclease.IsEnzyme(bvEnzymeStrand))    // found enzyme
+        bdEndonuclease.Digest(*pLane, nAmplicon, szStrand.length(), vSite);
+        found = true;
+    }   // look up the sites of all the enzymes in the index, or find them in one pass
+
+    for (list<BitVector>::iterator i = bvEndonuclease.begin();
+        !(i == bvEndonuclease.end()); ++i, ++e)
+    {
+        prior = 0; trf.clear();
+
+        if (found)
         {
-            size = bvEnzymeStrand.GetDistance() - bvEndonuclease.GetOffset() - prior;
-            trf.push_back(size); prior += size; bvEnzymeStrand.Clear();
+            if (vSite[e].count > 0)
+            {
+                trf.push_back(vSite[e].first); prior = vSite[e].last;
+            }   // only the first and the last cuts shape the terminal fragments
+        }
+        else
+        {
+            nEnzymeIndex = (*i).GetLength() - 1;        // index starts from 0
+            bvEnzymeStrand.SetDigestStrand((*i).GetLength(), szStrand);
+
+            while (nEnzymeIndex < static_cast<int>(szStrand.length()))
+            {
+                if ((*i).IsEnzyme(bvEnzymeStrand))    // found enzyme
+                {
+                    size = bvEnzymeStrand.GetDistance() - (*i).GetOffset() - prior;
+                    trf.push_back(size); prior += size; bvEnzymeStrand.Clear();
 
 #ifdef _VERBOSE
-            cout << "prior: " << prior << endl << " size: " << size << endl;
+                    cout << "prior: " << prior << endl << " size: " << size << endl;
 #endif  // _VERBOSE
-        }
+                }
 
-        bvEnzymeStrand.AddNucleotide(szStrand[++nEnzymeIndex]);
-    }   // now, search for the restriction enzymes
+                if (++nEnzymeIndex < static_cast<int>(szStrand.length()))
+                {
+                    bvEnzymeStrand.AddNucleotide(szStrand[nEnzymeIndex]);
+                }   // the view ends at the amplicon; no terminating null to roll in
+            }   // now, search for the restriction enzymes
+        }   // roll the bit streams one nucleotide at a time
 
-    if (trf.empty())      // full length
-    {
-        nForwardFragment = nReverseFragment = full;
-    }   // now, fix the first and last fragments
-    else
-    {
-        nForwardFragment = trf.front() + bvForwardPrimer.GetLength();
-        nReverseFragment = szStrand.length() - prior + bvReversePrimer.GetLength();
-    }   // calculate the forward and reverse fragment sizes
+        if (!trf.empty())
+        {
+            vForwardFragment[e] = trf.front() + bvForwardPrimer.GetLength();
+            vReverseFragment[e] = szStrand.length() - prior + bvReversePrimer.GetLength();
+            vCut[e] = true; ++cut;
+        }   // otherwise, the fragments are full length
 
 #ifdef _VERBOSE
-    cout << "forward length: " << nForwardFragment << endl;
-    cout << "reverse length: " << nReverseFragment << endl;
+        cout << "forward length: " << vForwardFragment[e] << endl;
+        cout << "reverse length: " << vReverseFragment[e] << endl;
 #endif  // _VERBOSE
+    }   // loop through the list of restriction enzymes
 
-    // return true if the enzyme can be found; otherwise returns false
-    return(!trf.empty());
+    return(cut);
 }   // end of Digest()
 
 #endif  // _ERPA_H
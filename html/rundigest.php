@@ -110,8 +110,7 @@ if ( !$run_digest )
 }
 else
 {
-    $cmd_line = "./ispar $unique &";
-    system( $cmd_line );        // call the search program
+    RunProgram( "ispar", $unique );   // call the search program
 
     $php_file = $unique . ".php?page=0";
 
@@ -93,8 +93,7 @@ if ( !$run_enzyme )
 }
 else
 {
-    $cmd_line = "./erpa $unique &";
-    system( $cmd_line );        // call the search program
+    RunProgram( "erpa", $unique );   // call the search program
 
     $php_file = $unique . ".php";
 
@@ -86,8 +86,7 @@ if ( !$run_trflp )
 }
 else
 {
-    $cmd_line = "./pat $unique &";
-    system( $cmd_line );        // call the search program
+    RunProgram( "pat", $unique );   // call the search program
     $php_file = $unique . '.php';
 
     DrawSystemLoad(); DrawProgress( 5000 );
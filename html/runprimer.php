@@ -99,8 +99,7 @@ if ( !$run_primer )
 }
 else
 {
-    $cmd_line = "./pspa $unique &";
-    system( $cmd_line );        // call the search program
+    RunProgram( "pspa", $unique );   // call the search program
 
     $php_file = $unique . ".php";
 
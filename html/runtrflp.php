@@ -94,8 +94,7 @@ if ( !$run_trflp )
 }
 else
 {
-    $cmd_line = "./trflp $unique &";
-    system( $cmd_line );        // call the search program
+    RunProgram( "trflp", $unique );   // call the search program
     $php_file = $unique . '.php';
 
     DrawSystemLoad(); DrawProgress( 5000 );
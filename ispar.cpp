@@ -31,11 +31,12 @@
 // support class implementation
 #include "ispar.h"
 #include "pthread.h"
+#include "seqscan.h"
+#include "ampcache.h"
 
 // force PHP to return immediately
 #define CLOSE_PHP   { fclose(stdin); fclose(stdout); fclose(stderr); };
 
-const unsigned int nMaxTHREAD = 4;
 const unsigned int nMaxBUFFER = 8192;
 
 // define the structure for digest data
@@ -549,82 +550,119 @@ bool WritePHP(
     ofs.close(); return(true);
 }   // end of WritePHP()
 
-// globally accessible classes for multithreading
-CmdParam cmd; SeqDB rdp;
-list<stRECORD> data;
-pthread_mutex_t mtxLockDBMS;    // critical region lock for database
-pthread_mutex_t mtxLockITEM;    // critical region lock for records
+/*
+ * a virtual digest; everything the analysis needs is kept in the job, so that several
+ * jobs can share a single scan of the database
+*/
+typedef struct
+{
+    CmdParam cmd;                   // parameters of the job
+    AmpliconCache cache;            // amplicons of the primer pair, if cached
+    SiteIndex index;                // restriction sites of the database, if indexed
+    SeedIndex seeds;                // primer seeds of the database, if indexed
+    list<stRECORD> records;         // fragments of every amplified sequence
+    pthread_mutex_t mtxLockITEM;    // critical region lock for records
+} stJOB;
 
 /*
- * the prodcution trflp function
+ * read the parameter file and set up the job
 */
-void* DoDigest(void*)
+void* OpenJob(
+    const char* _param)    // parameter file
 {
-    tRFLP rflp(cmd);
-    stRECORD item; bool run = false;
+    stJOB* job = new stJOB;
 
-    do
+    if (!job->cmd.OpenFile(_param))
     {
-        pthread_mutex_lock(&mtxLockDBMS);
-        // ** enter the critical section for database
-        run = rdp.NextRecord();     // retrive a sequence from the database
+        delete job; return(0);
+    }   // open the parameter file; every primer must fit into the bit streams
 
-        if (run)
-        {
-            rflp.SetStrand(rdp.GetOrigin());
-            item.locus = rdp.GetLocus(), item.organism = rdp.GetOrganism();
-            item.accession = rdp.GetAccession();
-        }   // set the sequence for the search
-        // ** leave the critical section for database
-        pthread_mutex_unlock(&mtxLockDBMS);
+    job->cache.Open(job->cmd);          // skip the primer search if the amplicons are known
+    job->index.Open(job->cmd);          // look up the restriction sites if they are indexed
+
+    if (!job->cache.IsCached())
+    {
+        job->seeds.Open(job->cmd);
+    }   // look up the windows of the primers if the amplicons are not known
+
+    pthread_mutex_init(&job->mtxLockITEM, NULL);   // initialize the lock for record
+    return(job);
+}   // end of OpenJob()
+
+/*
+ * parameters of the job
+*/
+CmdParam& JobParam(
+    void* _job)
+{
+    return(static_cast<stJOB*>(_job)->cmd);
+}   // end of JobParam()
+
+/*
+ * every worker digests with a class of its own
+*/
+void* StartWorker(
+    void* _job)
+{
+    return(new tRFLP(static_cast<stJOB*>(_job)->cmd));
+}   // end of StartWorker()
+
+/*
+ * the prodcution trflp function
+*/
+void ScanBatch(
+    void*       _job,       // the job
+    void*       _rflp,      // class of the worker
+    stBATCH*    _batch)    // records to be analyzed
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+    tRFLP& rflp = *static_cast<tRFLP*>(_rflp);
+    stRECORD item;
+
+    vector<stAMPLICON> amplicon;        // outcomes of the primer search, for the cache
 
-        if (!run || !rflp.Delimit())
+    for (int n = 0; n < _batch->count; ++n)
+    {
+        stSEQUENCE& seq = _batch->records[n];
+
+        if (!job.cache.Delimit(rflp, seq, _batch->first + n, amplicon, &job.seeds))
         {
             continue;
-        }   // skip if there is no more sequences or amplification fails
+        }   // skip if amplification fails
 
-        rflp.Digest();
+        item.locus = seq.locus, item.organism = seq.organism;
+        item.accession = seq.accession;
+
+        rflp.Digest(&job.index, _batch->first + n);
         rflp.GetFragment(item.forward, item.reverse);     // all fragments
         rflp.GetFragment(item.fshort, item.rshort);       // shortest fragments
 
-        pthread_mutex_lock(&mtxLockITEM);
+        pthread_mutex_lock(&job.mtxLockITEM);
         // ** enter the critical section for records
-        data.push_back(item);
+        job.records.push_back(item);
         // ** leave the critical section for database
-        pthread_mutex_unlock(&mtxLockITEM);
-    } while (run);
+        pthread_mutex_unlock(&job.mtxLockITEM);
+    }   // process every record of the batch
 
-    return(NULL);
-}   // end of DoDigest(); production function for trflp
+    job.cache.Store(_batch->first, amplicon);
+}   // end of ScanBatch(); production function for trflp
 
 /*
- * to compile, type:
- * g++ cmdparam.cpp seqdb.cpp bitvector.cpp ispar.cpp -o ispar.exe
+ * the records are added as they are digested; only the class is released
 */
-int main(int argc, char** argv)
+void StopWorker(
+    void*, void* _rflp)
 {
-    if (argc < 2) {
-        cout << "insufficient number of parameters" << endl;
-        return(1);
-    }
-
-    cmd.OpenFile(argv[1]);              // open the parameter file
-    rdp.OpenFile(cmd.GetDatabase());      // open the sequence database
-    data.clear();
-
-    pthread_mutex_init(&mtxLockDBMS, NULL);   // initialize the lock for database
-    pthread_mutex_init(&mtxLockITEM, NULL);   // initialize the lock for record
-    vector<pthread_t> pts(nMaxTHREAD, 0);     // a vector for pthread
-
-    for (unsigned int i = 0; i < pts.size(); ++i)
-    {
-        pthread_create(&pts[i], NULL, &DoDigest, NULL);
-    }   // first, spawn the threads
+    delete static_cast<tRFLP*>(_rflp);
+}   // end of StopWorker()
 
-    for (unsigned int j = 0; j < pts.size(); ++j)
-    {
-        pthread_join(pts[j], NULL);
-    }   // wait for all threads to complete
+/*
+ * sort the records and write the outputs; returns false if an output cannot be written
+*/
+bool CloseJob(
+    void* _job)
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
 
     bool (*SortOption[10])(const stRECORD&, const stRECORD&) =
     {
@@ -646,17 +684,61 @@ int main(int argc, char** argv)
         { WriteTXTs, WriteCSVs, WritePAT, WriteDATs, WritePHP }
     };
 
-    data.sort(*SortOption[cmd.SortOption()]);     // sort the output data
+    job.records.sort(*SortOption[job.cmd.SortOption()]);     // sort the output data
 
     // write the query results in different formats
-    WriteOutput[static_cast<int>(cmd.OutputShort())][0](data, cmd);
-    WriteOutput[static_cast<int>(cmd.OutputShort())][1](data, cmd);
-    WriteOutput[static_cast<int>(cmd.OutputShort())][2](data, cmd);
-    WriteOutput[static_cast<int>(cmd.OutputShort())][3](data, cmd);
-    WriteOutput[static_cast<int>(cmd.OutputShort())][4](data, cmd);
-
-    pthread_exit(NULL);
-    pthread_mutex_destroy(&mtxLockITEM);
-    pthread_mutex_destroy(&mtxLockDBMS);
+    bool written = WriteOutput[static_cast<int>(job.cmd.OutputShort())][0](job.records, job.cmd);
+    written &= WriteOutput[static_cast<int>(job.cmd.OutputShort())][1](job.records, job.cmd);
+    written &= WriteOutput[static_cast<int>(job.cmd.OutputShort())][2](job.records, job.cmd);
+    written &= WriteOutput[static_cast<int>(job.cmd.OutputShort())][3](job.records, job.cmd);
+    written &= WriteOutput[static_cast<int>(job.cmd.OutputShort())][4](job.records, job.cmd);
+
+    job.cache.Close();                  // keep the amplicons for the next run
+    job.index.Close();                  // release the site index
+    job.seeds.Close();                  // release the seed index
+    pthread_mutex_destroy(&job.mtxLockITEM);
+    delete &job;
+    return(written);
+}   // end of CloseJob()
+
+// the hooks of the analysis into the database scan
+const stANALYSIS stAnalysis =
+{
+    "ispar", OpenJob, JobParam, StartWorker, ScanBatch, StopWorker, CloseJob
+};
+
+/*
+ * to compile, type:
+ * g++ -std=c++17 -O3 -I. bitvector.cpp cmdparam.cpp seqdb.cpp threadpool.cpp seqqueue.cpp
+ *     seqscan.cpp ampcache.cpp siteindex.cpp seedindex.cpp ispar.cpp -o ispar -lpthread
+*/
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        cout << "insufficient number of parameters" << endl;
+        return(1);
+    }
+
+    void* job = OpenJob(argv[1]);       // open the parameter file
+
+    if (!job)
+    {
+        return(1);
+    }   // the parameter file cannot be used
+
+    CmdParam& cmd = JobParam(job);
+
+    if (argc > 2)
+    {
+        cmd.SetThreads(atoi(argv[2]));
+    }   // the number of threads on the command line overrides the parameter file
+
+    bool scanned = ScanDatabase(cmd.GetDatabase(), cmd.Threads(), vector<stQUERY>(1, { &stAnalysis, job }));
+
+    if (!CloseJob(job) || !scanned)
+    {
+        return(1);
+    }   // the database cannot be read, or an output cannot be written
+
     return(0);
 }   // end of main()
@@ -43,6 +43,7 @@
 #include "seqdb.h"
 #include "cmdparam.h"
 #include "bitvector.h"
+#include "siteindex.h"
 
 // for debugging purpose
 //#define _VERBOSE
@@ -58,9 +59,11 @@ public:
     tRFLP(CmdParam&);
     ~tRFLP() {};
 
-    bool SetStrand(const string&);
-    bool Delimit();     // delimit sequences with two primers
-    int Digest();       // cut sequences with restriction enzymes
+    bool SetStrand(string_view, const BitLane* = 0);
+    bool Delimit(stDELIMIT&); // delimit sequences with two primers
+    bool SetAmplicon(const stDELIMIT&); // delimit with an amplicon found before
+    bool Delimit()      { stDELIMIT range; return(Delimit(range)); }
+    int Digest(const SiteIndex* = 0, size_t = 0);   // cut sequences with restriction enzymes
 
     /*
      * forward distance: the distance between first nucleotide to forward primer
@@ -94,14 +97,18 @@ private:
     int nForwardShort, nReverseShort;
     int nForwardDistance, nReverseDistance;
     bool bForwardFound, bReverseFound;
+    const BitLane* pLane;       // bit lanes of the sequence, or 0 to roll the bit streams
+    int nAmplicon;              // offset of the amplicon in the bit lanes
 
     // binary representations for the primers and restriction enzymes
     BitVector bvForwardPrimer, bvReversePrimer;
     BitVector bvForwardStrand, bvReverseStrand, bvEnzymeStrand;
     list<BitVector> bvEndonuclease;
+    BitDigest bdEndonuclease;   // all the restriction enzymes, digested in one pass
+    vector<stDIGEST> vSite;     // restriction sites of each enzyme
     vector<int> vForwardFragment, vReverseFragment;
 
-    string szStrand;
+    string_view szStrand;       // view of the record, narrowed to the amplicon
 };  // end of class definition for tRFLP
 
 /*
@@ -129,7 +136,7 @@ tRFLP::tRFLP(
     for (int i = 0; i < _cmd.EndonucleaseCount(); ++i)
     {
         enzyme.SetEndonuclease(_cmd.GetEndonuclease(i));
-        bvEndonuclease.push_back(enzyme);
+        bvEndonuclease.push_back(enzyme); bdEndonuclease.AddEnzyme(enzyme);
 
 #ifdef _VERBOSE     // print out the restriction enzyme
         cout << "restriction enzyme: " << endl; enzyme.Print();
@@ -141,9 +148,11 @@ tRFLP::tRFLP(
  * set the sequence to be searched
 */
 bool tRFLP::SetStrand(
-    const string& _s)
+    string_view     _s,         // sequence to be searched
+    const BitLane*  _lane)     // bit lanes of the sequence, if available
 {
-    szStrand = _s;
+    szStrand = _s; nAmplicon = 0;
+    pLane = (_lane && (_lane->GetLength() == static_cast<int>(_s.length()))) ? _lane : 0;
 
     if (!(szStrand.length() > 0))
     {
@@ -154,6 +163,11 @@ bool tRFLP::SetStrand(
     cout << "szStrand: " << szStrand << endl;
 #endif
 
+    if (pLane)
+    {
+        return(true);
+    }   // the bit lanes are searched directly
+
     // convert primers and sequence into bit streams for search
     bvForwardStrand.SetForwardStrand(bvForwardPrimer.GetLength(), szStrand);
     bvReverseStrand.SetReverseStrand(bvReversePrimer.GetLength(), szStrand);
@@ -169,13 +183,30 @@ bool tRFLP::SetStrand(
 }   // end of SetStrand()
 
 /*
- * restrict the sequences with two primers
+ * restrict the sequences with two primers; the outcome is kept in _range, so that it
+ * can be given to SetAmplicon() later
 */
-bool tRFLP::Delimit()
+bool tRFLP::Delimit(
+    stDELIMIT& _range)     // positions of the primers and the amplicon
 {
     bForwardFound = bReverseFound = false;
     nForwardDistance = nReverseDistance = 0;
 
+    if (pLane)
+    {
+        bool found = pLane->Delimit(bvForwardPrimer, bvReversePrimer, _range);
+        bForwardFound = _range.bForward; bReverseFound = _range.bReverse;
+
+        if (found)
+        {
+            nForwardDistance = _range.forward; nReverseDistance = _range.reverse;
+            szStrand = szStrand.substr(_range.begin, _range.end - _range.begin + 1);
+            nAmplicon = _range.begin;
+        }   // same outcome as the interleaved search below
+
+        return(found);
+    }   // search the bit lanes of the sequence, 64 positions at a time
+
     // search for the forward and reverse primer
     while (nForwardIndex < nReverseIndex)
     {
@@ -199,6 +230,10 @@ bool tRFLP::Delimit()
             // pointer will one step further even though a match has been found
             nForwardDistance = bvForwardStrand.GetDistance() - 1;
             nReverseDistance = bvReverseStrand.GetDistance() - 1;
+            _range.forward = nForwardDistance; _range.reverse = nReverseDistance;
+            _range.begin = nForwardIndex; _range.end = nReverseIndex;
+            _range.bForward = _range.bReverse = true;
+            nAmplicon = nForwardIndex;
             szStrand = szStrand.substr(nForwardIndex, nReverseIndex - nForwardIndex + 1);
 
 #ifdef _VERBOSE         // print out some crucial variables
@@ -215,40 +250,81 @@ bool tRFLP::Delimit()
 }   // end of Delimit()
 
 /*
- * cut the sequence with the restriction enzyme(s)
+ * delimit the sequence with an amplicon that Delimit() has found before, such as one
+ * taken from the amplicon cache; the outcome is the same as that of the search. the
+ * amplicon must lie within the sequence
+*/
+bool tRFLP::SetAmplicon(
+    const stDELIMIT& _range)   // positions of the primers and the amplicon
+{
+    bForwardFound = _range.bForward; bReverseFound = _range.bReverse;
+    nForwardDistance = _range.forward; nReverseDistance = _range.reverse;
+    szStrand = szStrand.substr(_range.begin, _range.end - _range.begin + 1);
+    nAmplicon = _range.begin;
+    return(true);
+}   // end of SetAmplicon()
+
+/*
+ * cut the sequence with the restriction enzyme(s); with a site index, the sites are
+ * looked up in the index instead of searched for in the amplicon
 */
-int tRFLP::Digest()
+int tRFLP::Digest(
+    const SiteIndex*    _index,     // restriction sites of the database, if any
+    size_t              _record)   // number of the record in the database
 {
-    int prior, size, full;
+    int prior, size, full, e = 0;
     vector<int> trf;
     vForwardFragment.clear(); vReverseFragment.clear();
     full = bvForwardPrimer.GetLength() + bvReversePrimer.GetLength() + szStrand.length();
     nForwardShort = nReverseShort = full;
 
+    bool found = _index && _index->IsOpen() &&
+        _index->Digest(_record, nAmplicon, szStrand.length(), vSite);
+
+    if (!found && pLane)
+    {
+        bdEndonuclease.Digest(*pLane, nAmplicon, szStrand.length(), vSite);
+        found = true;
+    }   // look up the sites of all the enzymes in the index, or find them in one pass
+
     // loop through the list of restriction enzymes
     for (list<BitVector>::iterator i = bvEndonuclease.begin();
-        !(i == bvEndonuclease.end()); ++i)
+        !(i == bvEndonuclease.end()); ++i, ++e)
     {
-        bvEnzymeStrand.SetDigestStrand((*i).GetLength(), szStrand);
-        nEnzymeIndex = (*i).GetLength() - 1;
         prior = 0; trf.clear();
 
-        // now, search for the restriction enzymes
-        while (nEnzymeIndex < static_cast<int>(szStrand.length()))
+        if (found)
         {
-            if ((*i).IsEnzyme(bvEnzymeStrand))    // found enzyme
+            if (vSite[e].count > 0)
             {
-                size = bvEnzymeStrand.GetDistance() - (*i).GetOffset() - prior;
-                trf.push_back(size); prior += size; bvEnzymeStrand.Clear();
+                trf.push_back(vSite[e].first); prior = vSite[e].last;
+            }   // only the first and the last cuts shape the terminal fragments
+        }
+        else
+        {
+            bvEnzymeStrand.SetDigestStrand((*i).GetLength(), szStrand);
+            nEnzymeIndex = (*i).GetLength() - 1;
+
+            // now, search for the restriction enzymes
+            while (nEnzymeIndex < static_cast<int>(szStrand.length()))
+            {
+                if ((*i).IsEnzyme(bvEnzymeStrand))    // found enzyme
+                {
+                    size = bvEnzymeStrand.GetDistance() - (*i).GetOffset() - prior;
+                    trf.push_back(size); prior += size; bvEnzymeStrand.Clear();
 
 #ifdef _VERBOSE
-                cout << "prior: " << prior << endl;
-                cout << " size: " << size << endl;
+                    cout << "prior: " << prior << endl;
+                    cout << " size: " << size << endl;
 #endif  // _VERBOSE
-            }
+                }
 
-            bvEnzymeStrand.AddNucleotide(szStrand[++nEnzymeIndex]);
-        }
+                if (++nEnzymeIndex < static_cast<int>(szStrand.length()))
+                {
+                    bvEnzymeStrand.AddNucleotide(szStrand[nEnzymeIndex]);
+                }   // the view ends at the amplicon; no terminating null to roll in
+            }
+        }   // roll the bit streams one nucleotide at a time
 
         // now, fix the first and last fragments
         if (trf.empty())      // full length
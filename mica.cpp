@@ -0,0 +1,529 @@
+/*
+ * MICA.CPP
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * this program is the analysis server for the web front end. it reads the sequence
+ * databases into memory once, and then takes jobs over a local unix socket instead of
+ * having a new process load the database for every submission. a job is a single line
+ * with the name of the analysis, the parameter file, and optionally the number of
+ * threads, exactly as the analysis program would be called from the command line:
+ *
+ *     trflp 1234567890 [threads]
+ *
+ * the server answers "accepted <job>" or "error <reason>", and "done <status>" once the
+ * analysis has finished: 0 if it has written its outputs, 1 if the database cannot be
+ * read or an output cannot be written, and -1 if the pass did not run to the end. a
+ * client that does not want to wait may hang up right after the submission; one that has
+ * not sent its job line within a few seconds is told "error no job received". the jobs
+ * that are waiting when a pass starts, and that use the same database, run together in
+ * that pass: the database is read and expanded into bit lanes once, and every batch of
+ * records is handed to all the jobs of the pass, whatever their programs and parameters.
+ * the passes run one at a time, in the order the jobs are submitted, in a child process
+ * that inherits the preloaded databases, so every pass starts from a clean copy of the
+ * program state. the outputs of every job are the same as those of the stand-alone
+ * programs
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+
+/*
+ * everything the analysis programs include is included here first; the include guards
+ * then keep the headers out of the namespaces below
+*/
+#include <list>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <string>
+#include <cerrno>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "seqdb.h"
+#include "cmdparam.h"
+#include "bitvector.h"
+#include "threadpool.h"
+#include "seqqueue.h"
+#include "seqscan.h"
+#include "ampcache.h"
+#include "siteindex.h"
+#include "seedindex.h"
+
+/*
+ * every analysis program is compiled into a namespace of its own, since they all use
+ * the same names for their globals, classes, and functions
+*/
+namespace erpa
+{
+#include "erpa.cpp"
+}   // enzyme resolving power analysis
+
+namespace ispar
+{
+#include "ispar.cpp"
+}   // virtual digest
+
+namespace pat
+{
+#include "pat.cpp"
+}   // phylogenetic assignment with one labeled fragment
+
+namespace pspa
+{
+#include "pspa.cpp"
+}   // primer sequence prevalence analysis
+
+namespace trflp
+{
+#include "trflp.cpp"
+}   // t-rflp analysis (aplaus+)
+
+const int nMaxREQUEST = 4096;       // longest job line accepted from a client
+const int nMaxPENDING = 64;         // connections waiting to be accepted
+const int nPollINTERVAL = 50;       // milliseconds between checks on a running pass
+const int nMaxPASS = 16;            // most jobs that share a pass
+const int nMaxIDLE = 5;             // seconds a client is given to send its job line
+const mode_t nSocketMODE = 0660;    // only the server's user and group may submit jobs
+
+// the analysis programs the server can run
+const stANALYSIS* const stProgram[] =
+{
+    &erpa::stAnalysis,
+    &ispar::stAnalysis,
+    &pat::stAnalysis,
+    &pspa::stAnalysis,
+    &trflp::stAnalysis
+};
+
+// a submitted analysis
+typedef struct
+{
+    unsigned id;                    // job number, counted from the start of the server
+    int client;                     // connection of the client
+    pid_t pid;                      // process running the pass; 0 while it is waiting
+    const stANALYSIS* program;
+    string param;                   // parameter file
+    string threads;                 // number of threads; empty for the default
+    string database;                // sequence database named by the parameter file
+} stJOB;
+
+// a connection whose job line has not arrived in full yet
+typedef struct
+{
+    int client;                     // connection of the client
+    string line;                    // what the client has sent so far
+    time_t since;                   // when the connection was accepted
+} stCLIENT;
+
+// outcome of a job, as sent by the pass to the server
+typedef struct
+{
+    unsigned id;                    // job number
+    int status;                     // 0 if the outputs have been written; 1 otherwise
+} stSTATUS;
+
+/*
+ * send a line to the client; the client may already have hung up, which is fine
+*/
+void Reply(
+    int             _client,    // connection of the client
+    const string&   _line)     // message without the newline
+{
+    string line = _line + "\n";
+
+    if (write(_client, line.data(), line.length()) < 0)
+    {
+        return;
+    }   // ignore clients that have gone away
+}   // end of Reply()
+
+/*
+ * take what has arrived on a connection that poll() has found ready; a single read never
+ * blocks, so a slow client cannot hold up the server. returns true once the job line is
+ * complete, or the client has stopped sending
+*/
+bool Receive(
+    stCLIENT& _client)     // connection of the client
+{
+    char buffer[nMaxREQUEST]; ssize_t n = read(_client.client, buffer, sizeof(buffer));
+
+    if (n > 0)
+    {
+        _client.line.append(buffer, n);
+    }   // the line may arrive in several pieces
+
+    return(!(n > 0) || !(_client.line.find('\n') == string::npos) ||
+        !(_client.line.length() < static_cast<size_t>(nMaxREQUEST - 1)));
+}   // end of Receive()
+
+/*
+ * check that the job line of a connection names a known program and a readable
+ * parameter file
+*/
+bool ReadJob(
+    const stCLIENT& _client,    // connection of the client
+    stJOB&          _job)      // the job, if the line is valid
+{
+    char buffer[nMaxREQUEST];
+    size_t length = min(_client.line.length(), sizeof(buffer) - 1);
+
+    memcpy(buffer, _client.line.data(), length); buffer[length] = 0;
+
+    const char* delimit = " \t\r\n";
+    char* name = strtok(buffer, delimit);
+    char* param = name ? strtok(0, delimit) : 0;
+    char* threads = param ? strtok(0, delimit) : 0;
+
+    if (!param)
+    {
+        Reply(_client.client, "error usage: program parameter_file [threads]");
+        return(false);
+    }   // both the program and the parameter file are required
+
+    _job.program = 0;
+
+    for (size_t i = 0; i < sizeof(stProgram) / sizeof(stProgram[0]); ++i)
+    {
+        if (!strcmp(name, stProgram[i]->name))
+        {
+            _job.program = stProgram[i]; break;
+        }
+    }   // look up the program
+
+    if (!_job.program)
+    {
+        Reply(_client.client, string("error unknown program: ") + name);
+        return(false);
+    }   // only the analysis programs can be run
+
+    CmdParam cmd;
+
+    if (!cmd.OpenFile(param))
+    {
+        Reply(_client.client, string("error cannot use parameter file: ") + param);
+        return(false);
+    }   // the primers must fit as well; the database of the job decides the pass it joins
+
+    _job.client = _client.client; _job.pid = 0;
+    _job.param = param; _job.threads = threads ? threads : "";
+    _job.database = cmd.GetDatabase();
+    return(true);
+}   // end of ReadJob()
+
+/*
+ * start a pass with the first waiting job and every other waiting job on the same
+ * database, up to nMaxPASS of them. the pass runs in a child process that shares the
+ * preloaded databases with the server; the jobs are opened, scanned together, and then
+ * closed one by one, exactly as the stand-alone programs would do on their own. the pass
+ * uses as many threads as the most demanding of its jobs, and sends the outcome of every
+ * job back through _report once the job is closed
+*/
+pid_t StartPass(
+    list<stJOB>&            _queue,     // jobs waiting to run
+    const list<stCLIENT>&   _pending,   // connections still sending their job lines
+    int                     _listen,    // listening socket of the server
+    int&                    _report)   // read end of the outcomes of the pass
+{
+    vector<stJOB*> pass; int channel[2];
+
+    for (list<stJOB>::iterator i = _queue.begin(); !(i == _queue.end()); ++i)
+    {
+        if ((pass.size() < nMaxPASS) && ((*i).database == _queue.front().database))
+        {
+            pass.push_back(&(*i));
+        }
+    }   // the jobs on the database of the oldest job
+
+    if (pipe(channel) < 0)
+    {
+        return(-1);
+    }   // the outcomes of the jobs come back through the pipe
+
+    fflush(stdout); cout.flush();
+    pid_t pid = fork();
+
+    if (pid < 0)
+    {
+        close(channel[0]); close(channel[1]);
+        return(pid);
+    }   // the process cannot be created
+
+    if (pid > 0)
+    {
+        close(channel[1]); _report = channel[0];
+        cout << "pass of " << pass.size() << " job(s):";
+
+        for (size_t j = 0; j < pass.size(); ++j)
+        {
+            pass[j]->pid = pid; cout << " " << pass[j]->id;
+        }   // the jobs of the pass are running
+
+        cout << endl; return(pid);
+    }   // the server carries on
+
+    close(_listen);                     // the server answers the clients when done
+    close(channel[0]);
+
+    for (list<stJOB>::iterator i = _queue.begin(); !(i == _queue.end()); ++i)
+    {
+        close((*i).client);
+    }   // the pass does not talk to the clients
+
+    for (list<stCLIENT>::const_iterator i = _pending.begin(); !(i == _pending.end()); ++i)
+    {
+        close((*i).client);
+    }   // nor to those still sending their jobs
+
+    signal(SIGPIPE, SIG_DFL);
+
+    vector<stQUERY> query; vector<stJOB*> opened; int threads = -1;
+
+    for (size_t j = 0; j < pass.size(); ++j)
+    {
+        stQUERY q = { pass[j]->program, pass[j]->program->open(pass[j]->param.c_str()) };
+
+        if (!q.job)
+        {
+            continue;
+        }   // the parameter file has changed since the job was accepted
+
+        query.push_back(q); opened.push_back(pass[j]);
+        CmdParam& cmd = q.analysis->param(q.job);
+
+        if (!(pass[j]->threads.empty()))
+        {
+            cmd.SetThreads(atoi(pass[j]->threads.c_str()));
+        }   // the number of threads in the job line overrides the parameter file
+
+        threads = ((threads == 0) || !(cmd.Threads() > 0)) ? 0 : max(threads, cmd.Threads());
+    }   // open every job of the pass
+
+    bool scanned = !(query.empty()) && ScanDatabase(pass.front()->database.c_str(), threads, query);
+
+    for (size_t j = 0; j < query.size(); ++j)
+    {
+        bool written = query[j].analysis->close(query[j].job);
+        stSTATUS outcome = { opened[j]->id, (scanned && written) ? 0 : 1 };
+
+        if (write(channel[1], &outcome, sizeof(stSTATUS)) < 0)
+        {
+            break;
+        }   // the server reports the jobs without an outcome as failed
+    }   // write the outputs of every job
+
+    exit(0);
+}   // end of StartPass()
+
+/*
+ * open the unix socket the clients connect to; an old socket file left behind by a
+ * previous server is removed first, but nothing else at the path is touched. the socket
+ * is open to the user and the group of the server alone, so that the web front end can
+ * connect and no other user can have outputs written as the server
+*/
+int OpenSocket(
+    const char* _path)     // path of the socket
+{
+    struct sockaddr_un address; struct stat st; int fd;
+
+    if (!(strlen(_path) < sizeof(address.sun_path)))
+    {
+        cout << "socket path is too long: " << _path << endl;
+        return(-1);
+    }   // the path must fit into the address
+
+    if (!(lstat(_path, &st) < 0) && !S_ISSOCK(st.st_mode))
+    {
+        cout << "not a socket: " << _path << endl;
+        return(-1);
+    }   // never remove a file that is not a socket
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        cout << "cannot create socket: " << strerror(errno) << endl;
+        return(-1);
+    }   // make sure the socket can be created
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX; strcpy(address.sun_path, _path);
+    unlink(_path);
+
+    if ((bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) ||
+        (chmod(_path, nSocketMODE) < 0) || (listen(fd, nMaxPENDING) < 0))
+    {
+        cout << "cannot listen on socket: " << _path << ", " << strerror(errno) << endl;
+        close(fd); return(-1);
+    }   // no client can connect before the permissions are set
+
+    return(fd);
+}   // end of OpenSocket()
+
+/*
+ * to compile, type:
+ * g++ -std=c++17 -O3 -I. bitvector.cpp cmdparam.cpp seqdb.cpp threadpool.cpp seqqueue.cpp
+ *     seqscan.cpp ampcache.cpp siteindex.cpp seedindex.cpp mica.cpp -o mica -lpthread
+*/
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        cout << "usage: " << argv[0] << " socket database [database ...]" << endl;
+        return(1);
+    }   // the socket and at least one database are required
+
+    for (int i = 2; i < argc; ++i)
+    {
+        if (!SeqDB::Preload(argv[i]))
+        {
+            cout << "cannot load database: " << argv[i] << endl;
+            return(1);
+        }   // the database must be a regular file
+
+        cout << "database loaded: " << argv[i] << endl;
+    }   // read every database into memory once
+
+    int server = OpenSocket(argv[1]);
+
+    if (server < 0)
+    {
+        return(1);
+    }   // make sure the socket is ready
+
+    signal(SIGPIPE, SIG_IGN);       // clients may hang up at any time
+    cout << "waiting for jobs on " << argv[1] << endl;
+
+    list<stJOB> queue; stJOB job; unsigned id = 0;
+    list<stCLIENT> pending; vector<struct pollfd> watch;
+    vector<stSTATUS> outcome; stSTATUS next;
+    pid_t pass = 0; int report = -1, status;
+
+    while (true)
+    {
+        if (!(queue.empty()) && !(pass > 0) && ((pass = StartPass(queue, pending, server, report)) < 0))
+        {
+            Reply(queue.front().client, "done -1"); close(queue.front().client);
+            queue.pop_front(); pass = 0; continue;
+        }   // start the next pass as soon as the previous one is done
+
+        struct pollfd ready = { server, POLLIN, 0 };
+        watch.assign(1, ready);
+
+        for (list<stCLIENT>::iterator i = pending.begin(); !(i == pending.end()); ++i)
+        {
+            ready.fd = (*i).client; watch.push_back(ready);
+        }   // the connections whose job lines are still arriving
+
+        // wait for a client; check on the running pass and the slow clients every now and then
+        if (poll(watch.data(), watch.size(), (queue.empty() && pending.empty()) ? -1 : nPollINTERVAL) > 0)
+        {
+            size_t k = 1;
+
+            for (list<stCLIENT>::iterator i = pending.begin(); !(i == pending.end()); ++k)
+            {
+                if (!(watch[k].revents) || !Receive(*i))
+                {
+                    ++i; continue;
+                }   // the rest of the line is yet to come
+
+                if (ReadJob(*i, job))
+                {
+                    job.id = ++id; queue.push_back(job);
+                    Reply(job.client, "accepted " + to_string(job.id));
+                    cout << "job " << job.id << ": " << job.program->name << " " << job.param << endl;
+                }
+                else
+                {
+                    close((*i).client);
+                }   // the client has been told what is wrong
+
+                i = pending.erase(i);
+            }   // take the complete job lines
+
+            int client = (watch[0].revents & POLLIN) ? accept(server, 0, 0) : -1;
+
+            if (!(client < 0))
+            {
+                stCLIENT c = { client, "", time(0) };
+                pending.push_back(c);
+            }   // the job line is read once it arrives
+        }
+
+        for (list<stCLIENT>::iterator i = pending.begin(); !(i == pending.end()); )
+        {
+            if (time(0) - (*i).since < nMaxIDLE)
+            {
+                ++i; continue;
+            }   // the client still has time to send its job
+
+            Reply((*i).client, "error no job received");
+            close((*i).client); i = pending.erase(i);
+        }   // hang up on the clients that never send a job
+
+        if (!(pass > 0) || !(waitpid(pass, &status, WNOHANG) == pass))
+        {
+            continue;
+        }   // nothing has finished
+
+        for (outcome.clear(); read(report, &next, sizeof(stSTATUS)) == sizeof(stSTATUS); )
+        {
+            outcome.push_back(next);
+        }   // the pass has exited, so the pipe holds every outcome it has sent
+
+        close(report); report = -1;
+
+        for (list<stJOB>::iterator i = queue.begin(); !(i == queue.end()); )
+        {
+            if (!((*i).pid == pass))
+            {
+                ++i; continue;
+            }   // the job is still waiting
+
+            status = -1;
+
+            for (size_t k = 0; k < outcome.size(); ++k)
+            {
+                status = (outcome[k].id == (*i).id) ? outcome[k].status : status;
+            }   // a job without an outcome did not finish
+
+            cout << "job " << (*i).id << ": done " << status << endl;
+            Reply((*i).client, "done " + to_string(status));
+            close((*i).client); i = queue.erase(i);
+        }   // the pass has finished; let the clients know
+
+        pass = 0;
+    }   // serve the clients until the server is stopped
+
+    return(0);
+}   // end of main()
@@ -0,0 +1,402 @@
+/*
+ * MKINDEX.CPP
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * this program builds the restriction site index of a database; the sites of every
+ * enzyme in the catalogue, such as html/conf/enzyme.txt, are found once in every
+ * sequence, so that the analysis tools look them up instead of scanning the amplicons.
+ * with -s, it builds the primer seed index instead; every window of nMaxSEED bases is
+ * posted under its seed, so that the primers are only tested where they may match
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#include <seqdb.h>
+#include <siteindex.h>
+#include <seedindex.h>
+
+#include <sys/stat.h>
+
+/*
+ * read the restriction enzymes of the catalogue; each line holds the name and the
+ * restriction site, separated by '|', and '#' denotes the comments. the sites that are
+ * listed under more than one name are kept once
+*/
+bool ReadCatalogue(
+    const char*     _szFile,    // catalogue of the restriction enzymes
+    vector<string>& _enzyme)   // restriction sites
+{
+    ifstream ifs(_szFile); string line, site;
+
+    if (!ifs.is_open())
+    {
+        cout << "cannot open enzyme catalogue: " << _szFile << endl;
+        return(false);
+    }   // make sure the catalogue can be read
+
+    while (getline(ifs, line))
+    {
+        site = line.substr(line.find_last_of('|') + 1);
+        site.erase(0, site.find_first_not_of(" \t\r"));
+        site.erase(site.find_last_not_of(" \t\r") + 1);
+
+        if (line.empty() || (line[0] == '#') || site.empty())
+        {
+            continue;
+        }   // skip the comments and the blank lines
+
+        if (find(_enzyme.begin(), _enzyme.end(), site) == _enzyme.end())
+        {
+            _enzyme.push_back(site);
+        }   // the same site may be sold under several names
+    }
+
+    return(!_enzyme.empty());
+}   // end of ReadCatalogue()
+
+/*
+ * append the sites of a record; the number of sites before each enzyme comes first,
+ * then the sites of every enzyme, each number taking the size of T
+*/
+template <class T> void Append(
+    vector<char>&                   _block,     // sites of the record
+    const vector< vector<int> >&    _site)     // sites of each enzyme
+{
+    T number = 0;
+
+    for (unsigned int e = 0; !(e > _site.size()); ++e)
+    {
+        _block.insert(_block.end(), reinterpret_cast<const char*>(&number),
+            reinterpret_cast<const char*>(&number) + sizeof(T));
+        number += (e < _site.size()) ? _site[e].size() : 0;
+    }   // the number of sites before each enzyme, and the total
+
+    for (unsigned int e = 0; e < _site.size(); ++e)
+    {
+        for (unsigned int k = 0; k < _site[e].size(); ++k)
+        {
+            number = static_cast<T>(_site[e][k]);
+            _block.insert(_block.end(), reinterpret_cast<const char*>(&number),
+                reinterpret_cast<const char*>(&number) + sizeof(T));
+        }
+    }   // the first base of every site
+}   // end of Append()
+
+/*
+ * pad the file with zeros up to the next multiple of 8 bytes
+*/
+void Align(
+    ofstream& _out, uint64_t& _offset)
+{
+    static const char zero[8] = { 0 };
+    size_t pad = (8 - _offset % 8) % 8;
+
+    _out.write(zero, pad); _offset += pad;
+}   // end of Align()
+
+/*
+ * post every window of the record under the seeds it may stand for; the postings are
+ * the seed and the base of the block where the window starts. returns false if a window
+ * is too ambiguous to be expanded, in which case the record is searched as before
+*/
+bool Post(
+    const BitLane&                          _lane,      // expanded sequence
+    uint32_t                                _start,     // first base of the record in the block
+    vector<pair<uint16_t, uint32_t> >&      _post)     // postings of the block
+{
+    unsigned int seed[nMaxSEED_EXPAND], allowed[nMaxSEED];
+    unsigned int code = 0, ambiguous = 0; int none = -1;
+
+    for (int i = 0; i < _lane.GetLength(); ++i)
+    {
+        unsigned int a = 0;
+
+        for (int n = 0; n < nMaxNUCLEOTIDE; ++n)
+        {
+            a |= ((_lane.GetStream(n)[i >> 6] >> (i & 63)) & 0x1) << n;
+        }   // the nucleotides of the base
+
+        allowed[i % nMaxSEED] = a; none = (a) ? none : i;
+        code = ((code << 2) | ((a) ? __builtin_ctz(a) : 0)) & (nMaxSEED_TABLE - 1);
+        ambiguous = ((ambiguous << 1) | (__builtin_popcount(a) > 1)) & 0xFF;
+
+        int pos = i - nMaxSEED + 1, count = 1; seed[0] = code;
+
+        if ((pos < 0) || !(none < pos))
+        {
+            continue;
+        }   // a base that allows no nucleotide never matches the conserved region
+
+        for (unsigned int m = ambiguous; m; m &= m - 1)
+        {
+            int j = __builtin_ctz(m); unsigned int base = allowed[(i - j) % nMaxSEED];
+            int next = __builtin_popcount(base) * count;
+
+            if (next > nMaxSEED_EXPAND)
+            {
+                return(false);
+            }   // far too ambiguous to be posted under every seed
+
+            for (int n = nMaxNUCLEOTIDE - 1, e = next; !(n < 0); --n)
+            {
+                if (!((base >> n) & 0x1))
+                {
+                    continue;
+                }
+
+                for (int c = count - 1; !(c < 0); --c)
+                {
+                    seed[--e] = (seed[c] & ~(0x3 << (2 * j))) | (n << (2 * j));
+                }
+            }   // expand from the back, so that the seeds are not overwritten
+
+            count = next;
+        }   // bit j of the mask is the base j bases before the end of the window
+
+        for (int k = 0; k < count; ++k)
+        {
+            _post.push_back(make_pair(static_cast<uint16_t>(seed[k]), _start + pos));
+        }
+    }   // the window ending at every base
+
+    return(true);
+}   // end of Post()
+
+/*
+ * sort the postings of a block by seed and write them after the first posting of every
+ * seed; the postings of a seed keep the order of the bases
+*/
+void WriteBlock(
+    ofstream&                                   _out,       // seed index
+    uint64_t&                                   _offset,    // current offset of the file
+    const vector<pair<uint16_t, uint32_t> >&    _post,      // postings of the block
+    stSEEDBLOCK&                                _block)    // block table entry
+{
+    vector<uint32_t> bucket(nMaxSEED_TABLE + 1, 0), posting(_post.size());
+
+    for (size_t e = 0; e < _post.size(); ++e)
+    {
+        ++bucket[_post[e].first + 1];
+    }   // number of postings of every seed
+
+    for (int s = 0; s < nMaxSEED_TABLE; ++s)
+    {
+        bucket[s + 1] += bucket[s];
+    }   // first posting of every seed
+
+    vector<uint32_t> next(bucket.begin(), bucket.end() - 1);
+
+    for (size_t e = 0; e < _post.size(); ++e)
+    {
+        posting[next[_post[e].first]++] = _post[e].second;
+    }   // the postings were made in the order of the bases
+
+    Align(_out, _offset);
+    _block.postings = _post.size(); _block.offset = _offset;
+    _out.write(reinterpret_cast<const char*>(bucket.data()), bucket.size() * sizeof(uint32_t));
+    _out.write(reinterpret_cast<const char*>(posting.data()), posting.size() * sizeof(uint32_t));
+    _offset += (bucket.size() + posting.size()) * sizeof(uint32_t);
+}   // end of WriteBlock()
+
+/*
+ * build the primer seed index of the database; the records are indexed in blocks of
+ * about nSeedBLOCK bases, so that the postings of a block fit in 32 bits
+*/
+int BuildSeeds(
+    const char*     _szDatabase,    // sequence database
+    const char*     _szFile)       // seed index
+{
+    SeqDB rdp; struct stat info;
+
+    if ((stat(_szDatabase, &info) < 0) || (!rdp.MapFile(_szDatabase) && !rdp.OpenFile(_szDatabase)))
+    {
+        cout << "cannot open database: " << _szDatabase << endl;
+        return(1);
+    }   // map the sequence database; otherwise, read it as a stream
+
+    ofstream out(_szFile, ios::out | ios::binary | ios::trunc);
+
+    if (!out.is_open())
+    {
+        cout << "cannot create seed index: " << _szFile << endl;
+        return(1);
+    }   // make sure the output file can be created
+
+    stSEQUENCE seq; stSEEDHEADER header; BitLane lane;
+    stSEEDBLOCK block = { 0, 0, 0, 0 }; vector<stSEEDBLOCK> table;
+    vector<pair<uint16_t, uint32_t> > post; vector<uint32_t> start; vector<unsigned char> flag;
+    uint64_t offset = sizeof(stSEEDHEADER), postings = 0, bases = 0, flagged = 0;
+
+    memset(&header, 0, sizeof(stSEEDHEADER));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(stSEEDHEADER));
+
+    while (rdp.NextRecord(seq))
+    {
+        if ((block.records > 0) && (bases + seq.origin.length() > static_cast<uint64_t>(nSeedBLOCK)))
+        {
+            WriteBlock(out, offset, post, block); table.push_back(block);
+            postings += post.size(); post.clear();
+            block.first = start.size(); block.records = 0; bases = 0;
+        }   // the block is full; start the next one
+
+        lane.Encode(seq.origin); start.push_back(bases);
+        flag.push_back(!Post(lane, bases, post)); flagged += flag.back();
+        bases += seq.origin.length(); ++block.records;
+    }   // the windows are posted as the records are read
+
+    if (block.records > 0)
+    {
+        WriteBlock(out, offset, post, block); table.push_back(block);
+        postings += post.size();
+    }   // the last block
+
+    Align(out, offset); header.block_offset = offset;
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(stSEEDBLOCK));
+    offset += table.size() * sizeof(stSEEDBLOCK);
+
+    header.start_offset = offset;
+    out.write(reinterpret_cast<const char*>(start.data()), start.size() * sizeof(uint32_t));
+    offset += start.size() * sizeof(uint32_t);
+
+    header.flag_offset = offset;
+    out.write(reinterpret_cast<const char*>(flag.data()), flag.size());
+
+    memcpy(header.magic, szSeedMAGIC, sizeof(szSeedMAGIC));
+    header.size = info.st_size; header.inode = info.st_ino;
+    header.mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    header.records = start.size(); header.blocks = table.size();
+    out.seekp(0); out.write(reinterpret_cast<const char*>(&header), sizeof(stSEEDHEADER));
+    out.close();
+
+    if (out.fail())
+    {
+        cout << "cannot write seed index: " << _szFile << endl;
+        return(1);
+    }   // make sure everything has been written
+
+    cout << "records: " << header.records << ", blocks: " << header.blocks;
+    cout << ", postings: " << postings << ", not indexed: " << flagged << endl;
+    return(0);
+}   // end of BuildSeeds()
+
+int main(int argc, char** argv)
+{
+    if ((argc == 4) && !(strcmp(argv[1], "-s")))
+    {
+        return(BuildSeeds(argv[2], argv[3]));
+    }   // the primer seed index
+
+    if (argc < 4)
+    {
+        cout << "usage: " << argv[0] << " database enzyme.txt output.idx" << endl;
+        cout << "       " << argv[0] << " -s database output.sdx" << endl;
+        return(1);
+    }   // make sure the database, the catalogue, and the output file are specified
+
+    vector<string> enzyme; BitDigest digest; BitVector bv;
+
+    if (!ReadCatalogue(argv[2], enzyme))
+    {
+        return(1);
+    }   // the catalogue must list at least one enzyme
+
+    for (unsigned int e = 0; e < enzyme.size(); ++e)
+    {
+        bv.SetEndonuclease(enzyme[e]);
+
+        if (!digest.AddEnzyme(bv))
+        {
+            cout << "restriction site is too long: " << enzyme[e] << endl;
+            return(1);
+        }   // the bit streams hold at most 128 bases
+    }   // compile all the enzymes into one table
+
+    SeqDB rdp; struct stat info;
+
+    if ((stat(argv[1], &info) < 0) || (!rdp.MapFile(argv[1]) && !rdp.OpenFile(argv[1])))
+    {
+        cout << "cannot open database: " << argv[1] << endl;
+        return(1);
+    }   // map the sequence database; otherwise, read it as a stream
+
+    ofstream out(argv[3], ios::out | ios::binary | ios::trunc);
+
+    if (!out.is_open())
+    {
+        cout << "cannot create site index: " << argv[3] << endl;
+        return(1);
+    }   // make sure the output file can be created
+
+    stSEQUENCE seq; stSITEHEADER header; BitLane lane;
+    vector< vector<int> > site; vector<char> block;
+    vector<uint64_t> table; uint64_t offset = sizeof(stSITEHEADER), sites = 0, count;
+
+    memset(&header, 0, sizeof(stSITEHEADER));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(stSITEHEADER));
+
+    while (rdp.NextRecord(seq))
+    {
+        lane.Encode(seq.origin); sites += (count = digest.Locate(lane, site));
+        block.clear();
+
+        if ((seq.origin.length() < 65536) && (count < 65536))
+        {
+            table.push_back(offset); Append<uint16_t>(block, site);
+        }
+        else
+        {
+            table.push_back(offset | uWideSITES); Append<uint32_t>(block, site);
+        }   // 16 bits for each number if they all fit
+
+        block.resize((block.size() + 3) & ~static_cast<size_t>(3), 0);
+        out.write(block.data(), block.size()); offset += block.size();
+    }   // the sites are written as the records are read
+
+    table.push_back(offset);
+    Align(out, offset); header.table_offset = offset;
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(uint64_t));
+    offset += table.size() * sizeof(uint64_t);
+
+    header.enzyme_offset = offset;
+
+    for (unsigned int e = 0; e < enzyme.size(); ++e)
+    {
+        out.write(enzyme[e].c_str(), enzyme[e].length() + 1);
+    }   // each enzyme is terminated with a null
+
+    memcpy(header.magic, szSiteMAGIC, sizeof(szSiteMAGIC));
+    header.size = info.st_size; header.inode = info.st_ino;
+    header.mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    header.records = table.size() - 1; header.enzymes = enzyme.size();
+    out.seekp(0); out.write(reinterpret_cast<const char*>(&header), sizeof(stSITEHEADER));
+    out.close();
+
+    if (out.fail())
+    {
+        cout << "cannot write site index: " << argv[3] << endl;
+        return(1);
+    }   // make sure everything has been written
+
+    cout << "records: " << header.records << ", enzymes: " << enzyme.size();
+    cout << ", sites: " << sites << endl;
+    return(0);
+}   // end of main()
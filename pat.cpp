@@ -35,12 +35,12 @@
 // support class implementation
 #include <pat.h>
 #include <pthread.h>
+#include <seqscan.h>
+#include <ampcache.h>
 
 // force PHP to return immediately
 #define CLOSE_PHP       { fclose(stdin); fclose(stdout); fclose(stderr); };
 
-const unsigned int nMaxTHREAD = 4;
-
 /*
  * sort by the species abundance in ascending order
 */
@@ -107,9 +107,9 @@ bool SortFragmentD(
 */
 bool WriteDAT(
     list<stNICHE>&  _niche,     // plausible community profile based on trflp data
-    CmdParam&       _cmd)      // command-line parameters
+    const string&   _name)     // output filename without an extension
 {
-    string name = _cmd.GetFilename();
+    string name = _name;
     name += ".dat";         // add an extension
     ofstream ofs(name.c_str(), ios::trunc);
     char buffer[nMaxBUFFER];
@@ -148,9 +148,10 @@ bool WriteDAT(
 */
 bool WriteTXT(
     list<stNICHE>&  _niche,     // fragment data storage
-    CmdParam&       _cmd)      // command-line parameters
+    CmdParam&       _cmd,       // command-line parameters
+    const string&   _name)     // output filename without an extension
 {
-    string name = _cmd.GetFilename();
+    string name = _name;
     name += ".txt";             // add an extension
     ofstream ofs(name.c_str(), ios::trunc);
     char buffer[nMaxBUFFER];
@@ -198,9 +199,10 @@ bool WriteTXT(
 */
 bool WriteCSV(
     list<stNICHE>& _niche,      // fragment data storage
-    CmdParam&      _cmd)       // command-line parameters
+    CmdParam&      _cmd,        // command-line parameters
+    const string&  _name)      // output filename without an extension
 {
-    string name = _cmd.GetFilename();
+    string name = _name;
     name += ".csv";             // add an extension
     ofstream ofs(name.c_str(), ios::trunc);
     char buffer[nMaxBUFFER];
@@ -237,9 +239,9 @@ bool WriteCSV(
  * draw the output in PHP format for web display
 */
 bool WritePHP(
-    CmdParam& _cmd)    // command-line parameters
+    const string& _name)    // output filename without an extension
 {
-    string name = _cmd.GetFilename();
+    string name = _name;
     name += ".php";             // add and extension
     ofstream ofs(name.c_str(), ios::trunc);
 
@@ -251,102 +253,154 @@ bool WritePHP(
     ofs << "<?php" << endl
         << "  require \"shared.data.inc\";" << endl
         << "  DrawHeader(\"MiCA: Phylogenetic Analysis (PAT+) Output\");" << endl
-        << "  DrawPAT(" << _cmd.GetFilename() << ");" << endl
+        << "  DrawPAT(" << _name << ");" << endl
         << "  DrawFooter();" << endl << "?>" << endl;
     ofs.close(); return(true);
 }   // end of WritePHP()
 
-// globally accessible classes for multithreading
-CmdParam cmd; SeqDB rdp;
-list<stNICHE> niche;
-pthread_mutex_t mtxLock;    // critical region lock for database and records
-
 /*
- * the prodcution trflp function
+ * a phylogenetic assignment; everything the analysis needs is kept in the job, so that
+ * several jobs can share a single scan of the database
 */
-void* DoTRFLP(void*)
+typedef struct
 {
-    int forward, reverse; bool run = false; stNICHE item;
+    CmdParam cmd;                       // parameters of the job
+    AmpliconCache cache;                // amplicons of the primer pair, if cached
+    SiteIndex index;                    // restriction sites of the database, if indexed
+    SeedIndex seeds;                    // primer seeds of the database, if indexed
+    cPAT* rflp;                         // adds up the fragment counts of the workers
+    list<cPAT> worker;                  // one instance for each worker
+    vector< list<stNICHE> > niche;      // community profile of each sample
+    pthread_mutex_t mtxLock;            // critical region lock for the job
+} stJOB;
 
-    pthread_mutex_lock(&mtxLock);
-    // ** enter the critical section for database
-    cPAT rflp(cmd);   // instantiate trflp class with parameters
-    // ** leave the critical section for database
-    pthread_mutex_unlock(&mtxLock);
+/*
+ * read the parameter file and set up the job
+*/
+void* OpenJob(
+    const char* _param)    // parameter file
+{
+    stJOB* job = new stJOB;
 
-    do
+    if (!job->cmd.OpenFile(_param))
     {
-        pthread_mutex_lock(&mtxLock);
-        // ** enter the critical section for database
-        run = rdp.NextRecord();     // retrive a sequence from the database
+        delete job; return(0);
+    }   // open the parameter file; every primer must fit into the bit streams
 
-        if (run)
-        {
-            rflp.SetStrand(rdp.GetOrigin());
-            item.organism = rdp.GetOrganism(), item.accession = rdp.GetAccession();
-        }   // set the sequence for the search
-        // ** leave the critical section for database
-        pthread_mutex_unlock(&mtxLock);
+    job->cache.Open(job->cmd);          // skip the primer search if the amplicons are known
+    job->index.Open(job->cmd);          // look up the restriction sites if they are indexed
 
-        if (!run || !rflp.Delimit())
-        {
-            continue;           // if primers cannot be found, do nothing
-        }   // delimit the sequences with two primers
+    if (!job->cache.IsCached())
+    {
+        job->seeds.Open(job->cmd);
+    }   // look up the windows of the primers if the amplicons are not known
 
-        rflp.Digest(forward, reverse);    // perform restriction digest
-        item.predict = static_cast<double>(forward);
+    job->rflp = new cPAT(job->cmd);
+    job->niche.assign(job->rflp->SampleCount(), list<stNICHE>());
+    pthread_mutex_init(&job->mtxLock, NULL);     // initialize the lock for the job
+    return(job);
+}   // end of OpenJob()
 
-        if (!rflp.MatchSample(item))
-        {
-            continue;
-        }   // only use the forward fragment for species identification
+/*
+ * parameters of the job
+*/
+CmdParam& JobParam(
+    void* _job)
+{
+    return(static_cast<stJOB*>(_job)->cmd);
+}   // end of JobParam()
 
-        pthread_mutex_lock(&mtxLock);
-        // ** enter the critical section for database
-        niche.push_back(item);
-        // ** leave the critical section for database
-        pthread_mutex_unlock(&mtxLock);
-    } while (run);
+/*
+ * the class of a worker is owned by the job, which adds up the fragment counts of all
+ * workers once they are finished
+*/
+void* StartWorker(
+    void* _job)
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+
+    pthread_mutex_lock(&job.mtxLock);
+    // ** enter the critical section for the job
+    job.worker.emplace_back(job.cmd); cPAT* rflp = &job.worker.back();
+    // ** leave the critical section for the job
+    pthread_mutex_unlock(&job.mtxLock);
 
-    return(NULL);
-}   // end of DoTRFLP()
+    return(rflp);
+}   // end of StartWorker()
 
 /*
- * to compile, type:
- * g++ cmdparam.cpp seqdb.cpp bitvector.cpp pat.cpp -o pat
- *
- * note: for better performance, type:
- * g++ -O3 -static cmdparam.cpp seqdb.cpp bitvector.cpp pat.cpp -o pat
- *
- * last updated on July 7, 2007
+ * the prodcution trflp function; every record is digested once and matched against
+ * all samples
 */
-int main(int argc, char** argv)
+void ScanBatch(
+    void*       _job,       // the job
+    void*       _rflp,      // class of the worker
+    stBATCH*    _batch)    // records to be analyzed
 {
-    cmd.OpenFile(argv[1]);              // open the parameter file
-    rdp.OpenFile(cmd.GetDatabase());      // open the sequence database
-    niche.clear();
+    stJOB& job = *static_cast<stJOB*>(_job);
+    cPAT& rflp = *static_cast<cPAT*>(_rflp);
+    int forward, reverse; stNICHE item;
+    vector< list<stNICHE> > found(rflp.SampleCount());
 
-    pthread_mutex_init(&mtxLock, NULL);   // initialize the lock for database
-    vector<pthread_t> pts(nMaxTHREAD, 0);     // a vector for pthread
+    vector<stAMPLICON> amplicon;        // outcomes of the primer search, for the cache
 
-    for (unsigned int i = 0; i < pts.size(); ++i)
+    for (int n = 0; n < _batch->count; ++n)
     {
-        pthread_create(&pts[i], NULL, &DoTRFLP, NULL);
-    }   // first, spawn the threads
+        stSEQUENCE& seq = _batch->records[n];
 
-    for (unsigned int j = 0; j < pts.size(); ++j)
-    {
-        pthread_join(pts[j], NULL);
-    }   // wait for all threads to complete
+        if (!job.cache.Delimit(rflp, seq, _batch->first + n, amplicon, &job.seeds))
+        {
+            continue;           // if primers cannot be found, do nothing
+        }   // delimit the sequences with two primers
+
+        item.organism = seq.organism, item.accession = seq.accession;
 
-    cPAT rflp(cmd);
+        rflp.Digest(forward, reverse, &job.index, _batch->first + n);    // perform restriction digest
+        item.predict = static_cast<double>(forward);
 
-    for (list<stNICHE>::iterator n = niche.begin(); !(n == niche.end()); n++)
+        for (int k = 0; k < rflp.SampleCount(); ++k)
+        {
+            if (rflp.MatchSample(item, k))
+            {
+                found[k].push_back(item);
+            }   // only use the forward fragment for species identification
+        }   // match the fragment against every sample
+    }   // process every record of the batch
+
+    job.cache.Store(_batch->first, amplicon);
+
+    pthread_mutex_lock(&job.mtxLock);
+    // ** enter the critical section for records
+    for (int k = 0; k < rflp.SampleCount(); ++k)
     {
-        rflp.MatchSample(*n);
-    }   // match the sample again
+        job.niche[k].splice(job.niche[k].end(), found[k]);
+    }   // move the matches of the batch to the community profiles
+    // ** leave the critical section for records
+    pthread_mutex_unlock(&job.mtxLock);
+}   // end of ScanBatch()
+
+/*
+ * nothing to merge; the fragment counts are added up when the job is closed
+*/
+void StopWorker(
+    void*, void*)
+{
+}   // end of StopWorker()
 
-    rflp.SetAbundance(niche);   // calculate the relative abundance
+/*
+ * calculate the abundances and write the outputs of every sample; returns false if an
+ * output cannot be written
+*/
+bool CloseJob(
+    void* _job)
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+    cPAT& rflp = *job.rflp;
+
+    for (list<cPAT>::iterator w = job.worker.begin(); !(w == job.worker.end()); ++w)
+    {
+        rflp.AddCount(*w);
+    }   // add up the fragment counts of every worker
 
     bool (*SortOption[6])(const stNICHE&, const stNICHE&) =
     {
@@ -358,16 +412,72 @@ int main(int argc, char** argv)
         SortOrganismD   // sort by the species name is descending order
     };  // nasty function pointers
 
-    niche.sort(SortOption[cmd.SortOption()]);
+    bool written = true;
+
+    for (int k = 0; k < rflp.SampleCount(); ++k)
+    {
+        string name = job.cmd.GetFilename();
+
+        if (rflp.SampleCount() > 1)
+        {
+            name += "_" + to_string(k + 1);
+        }   // in batch mode, the output of each sample is numbered in the listed order
+
+        rflp.SetAbundance(job.niche[k], k);   // calculate the relative abundance
+        job.niche[k].sort(SortOption[job.cmd.SortOption()]);
+
+        /*
+         * write the output in various formats; explicitly signal the compiler that these
+         * funcation calls do not require any specific order. the compiler is free to
+         * rearrange for processor dispatch and parallel processing.
+        */
+        written &= WriteTXT(job.niche[k], job.cmd, name) & WritePHP(name) &
+            WriteCSV(job.niche[k], job.cmd, name) & WriteDAT(job.niche[k], name);
+    }   // write a separate set of outputs for every sample
+
+    job.cache.Close();                  // keep the amplicons for the next run
+    job.index.Close();                  // release the site index
+    job.seeds.Close();                  // release the seed index
+    pthread_mutex_destroy(&job.mtxLock);
+    delete job.rflp; delete &job;
+    return(written);
+}   // end of CloseJob()
+
+// the hooks of the analysis into the database scan
+const stANALYSIS stAnalysis =
+{
+    "pat", OpenJob, JobParam, StartWorker, ScanBatch, StopWorker, CloseJob
+};
+
+/*
+ * to compile, type:
+ * g++ -std=c++17 -O3 -I. bitvector.cpp cmdparam.cpp seqdb.cpp threadpool.cpp seqqueue.cpp
+ *     seqscan.cpp ampcache.cpp siteindex.cpp seedindex.cpp pat.cpp -o pat -lpthread
+ *
+ * last updated on July 7, 2007
+*/
+int main(int argc, char** argv)
+{
+    void* job = OpenJob(argv[1]);       // open the parameter file
 
-    /*
-     * write the output in various formats; explicitly signal the compiler that these
-     * funcation calls do not require any specific order. the compiler is free to
-     * rearrange for processor dispatch and parallel processing.
-    */
-    WriteTXT(niche, cmd), WritePHP(cmd), WriteCSV(niche, cmd), WriteDAT(niche, cmd);
+    if (!job)
+    {
+        return(1);
+    }   // the parameter file cannot be used
+
+    CmdParam& cmd = JobParam(job);
+
+    if (argc > 2)
+    {
+        cmd.SetThreads(atoi(argv[2]));
+    }   // the number of threads on the command line overrides the parameter file
+
+    bool scanned = ScanDatabase(cmd.GetDatabase(), cmd.Threads(), vector<stQUERY>(1, { &stAnalysis, job }));
+
+    if (!CloseJob(job) || !scanned)
+    {
+        return(1);
+    }   // the database cannot be read, or an output cannot be written
 
-    pthread_exit(NULL);
-    pthread_mutex_destroy(&mtxLock);
     return(0);
 }   // end of main()
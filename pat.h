@@ -38,11 +38,13 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <algorithm>
 
 // class implementations
 #include <seqdb.h>
 #include <cmdparam.h>
 #include <bitvector.h>
+#include <siteindex.h>
 
 // for debugging purpose
 //#define _VERBOSE
@@ -60,6 +62,15 @@ typedef struct
     unsigned int count; // number of fragments that has been matched
 } stSAMPLE;
 
+/*
+ * order the sample fragments by size
+*/
+inline bool SortSample(
+    const stSAMPLE& _a, const stSAMPLE& _b)
+{
+    return(_a.fragment < _b.fragment);
+}   // end of SortSample()
+
 /*
  * this structure establishes a relational model to associate the sample fragments
  * with the predicted fragments
@@ -71,7 +82,7 @@ typedef struct
     double observe;                 // matched sample forward terminal fragment
     double predict;                 // matched, predicted reverse fragment
     double biomass;                 // normalized, relative abundance
-    list<stSAMPLE>::iterator index; // index to the item in the sample profile
+    int index;                      // index to the item in the sample profile
 } stNICHE;
 
 /*
@@ -83,27 +94,35 @@ public:
     cPAT(CmdParam&);
     ~cPAT() {};
 
-    bool SetStrand(const string&);
-    bool Delimit();                         // delimit sequences with two primers
-    bool Digest(int&, int&);              // cut sequences with restriction enzymes
-    bool MatchSample(stNICHE&);           // match the predicted and observed fragments
-    bool SetAbundance(list<stNICHE>&);    // calculate the relative abundance of species
+    bool SetStrand(string_view, const BitLane* = 0);
+    bool Delimit(stDELIMIT&);             // delimit sequences with two primers
+    bool SetAmplicon(const stDELIMIT&);   // delimit with an amplicon found before
+    bool Delimit()      { stDELIMIT range; return(Delimit(range)); }
+    bool Digest(int&, int&, const SiteIndex* = 0, size_t = 0);    // cut sequences with restriction enzymes
+    bool MatchSample(stNICHE&, int = 0);        // match the predicted and observed fragments
+    bool SetAbundance(list<stNICHE>&, int = 0); // calculate the relative abundance of species
+    void AddCount(const cPAT&);                 // add the fragment counts of another instance
+    int SampleCount() const     { return(vSample.size()); }
 
     void PrintStrand() const    { cout << szStrand; }
 
 private:
     int nForwardIndex, nReverseIndex, nEnzymeIndex;
     bool bForwardFound, bReverseFound;
+    const BitLane* pLane;       // bit lanes of the sequence, or 0 to roll the bit streams
+    int nAmplicon;              // offset of the amplicon in the bit lanes
+    vector<stDIGEST> vSite;     // restriction sites found in the site index
     double dForwardBin;
-    list<stSAMPLE> lsSample;
+    vector< vector<stSAMPLE> > vSample;     // one profile for each sample, sorted by size
 
     // binary representations for the primers and restriction enzymes
     BitVector bvForwardPrimer, bvReversePrimer, bvEndonuclease;
     BitVector bvForwardStrand, bvReverseStrand, bvEnzymeStrand;
 
-    string szStrand;
+    string_view szStrand;       // view of the record, narrowed to the amplicon
 
-    bool LoadSample(list<stSAMPLE>&, const char*);
+    bool LoadSample(vector<stSAMPLE>&, const char*);
+    int FindSample(const vector<stSAMPLE>&, double) const;
 };  // end of class definition tRFLP
 
 /*
@@ -130,16 +149,23 @@ cPAT::cPAT(
 #endif  // _VERBOSE
 
     // load the observed fragments into memory
-    LoadSample(lsSample, _cmd.GetForwardSample());
+    vSample.resize(max(1, _cmd.ForwardSampleCount()));
+
+    for (size_t i = 0; i < vSample.size(); ++i)
+    {
+        LoadSample(vSample[i], _cmd.GetForwardSample(i));
+    }   // load every sample in the order they are listed
 }   // end of contructor
 
 /*
  * set the sequence to be searched
 */
 bool cPAT::SetStrand(
-    const string& _s)
+    string_view     _s,         // sequence to be searched
+    const BitLane*  _lane)     // bit lanes of the sequence, if available
 {
-    szStrand = _s;
+    szStrand = _s; nAmplicon = 0;
+    pLane = (_lane && (_lane->GetLength() == static_cast<int>(_s.length()))) ? _lane : 0;
 
     if (!(szStrand.length() > 0))
     {
@@ -150,6 +176,11 @@ bool cPAT::SetStrand(
     cout << "szStrand: " << szStrand << endl;
 #endif
 
+    if (pLane)
+    {
+        return(true);
+    }   // the bit lanes are searched directly
+
     // convert primers and sequence into bit streams for search
     bvForwardStrand.SetForwardStrand(bvForwardPrimer.GetLength(), szStrand);
     bvReverseStrand.SetReverseStrand(bvReversePrimer.GetLength(), szStrand);
@@ -165,12 +196,28 @@ bool cPAT::SetStrand(
 }   // end of SetStrand()
 
 /*
- * restrict the sequences with two primers
+ * restrict the sequences with two primers; the outcome is kept in _range, so that it
+ * can be given to SetAmplicon() later
 */
-bool cPAT::Delimit()
+bool cPAT::Delimit(
+    stDELIMIT& _range)     // positions of the primers and the amplicon
 {
     bForwardFound = bReverseFound = false;
 
+    if (pLane)
+    {
+        bool found = pLane->Delimit(bvForwardPrimer, bvReversePrimer, _range);
+        bForwardFound = _range.bForward; bReverseFound = _range.bReverse;
+
+        if (found)
+        {
+            szStrand = szStrand.substr(_range.begin, _range.end - _range.begin + 1);
+            nAmplicon = _range.begin;
+        }   // same outcome as the interleaved search below
+
+        return(found);
+    }   // search the bit lanes of the sequence, 64 positions at a time
+
     while (nForwardIndex < nReverseIndex)
     {
         if (!bForwardFound)
@@ -188,6 +235,11 @@ bool cPAT::Delimit()
         if (bForwardFound && bReverseFound)
         {
             // pointer will one step further even though a match has been found
+            _range.forward = bvForwardStrand.GetDistance() - 1;
+            _range.reverse = bvReverseStrand.GetDistance() - 1;
+            _range.begin = nForwardIndex; _range.end = nReverseIndex;
+            _range.bForward = _range.bReverse = true;
+            nAmplicon = nForwardIndex;
             szStrand = szStrand.substr(nForwardIndex, nReverseIndex - nForwardIndex + 1);
 
 #ifdef _VERBOSE         // print out some crucial variables
@@ -202,36 +254,76 @@ bool cPAT::Delimit()
 }   // end of Delimit()
 
 /*
- * cut the sequence with the restriction enzyme(s)
+ * delimit the sequence with an amplicon that Delimit() has found before, such as one
+ * taken from the amplicon cache; the outcome is the same as that of the search. the
+ * amplicon must lie within the sequence
+*/
+bool cPAT::SetAmplicon(
+    const stDELIMIT& _range)   // positions of the primers and the amplicon
+{
+    bForwardFound = _range.bForward; bReverseFound = _range.bReverse;
+    szStrand = szStrand.substr(_range.begin, _range.end - _range.begin + 1);
+    nAmplicon = _range.begin;
+    return(true);
+}   // end of SetAmplicon()
+
+/*
+ * cut the sequence with the restriction enzyme(s); with a site index, the sites are
+ * looked up in the index instead of searched for in the amplicon
 */
 bool cPAT::Digest(
-    int&    _forward,       // predicted forward fragment
-    int&    _reverse)      // predicted reverse fragment
+    int&                _forward,   // predicted forward fragment
+    int&                _reverse,   // predicted reverse fragment
+    const SiteIndex*    _index,     // restriction sites of the database, if any
+    size_t              _record)   // number of the record in the database
 {
     int size; int prior = 0;
     int full = bvForwardPrimer.GetLength() + bvReversePrimer.GetLength() + szStrand.length();
-    bvEnzymeStrand.SetDigestStrand(bvEndonuclease.GetLength(), szStrand);
-    nEnzymeIndex = bvEndonuclease.GetLength() - 1;      // index starts from 0
     vector<int> trf; trf.clear();                       // empty the fragment list
 
-    while (nEnzymeIndex < static_cast<int>(szStrand.length()))
+    if (_index && _index->IsOpen() && _index->Digest(_record, nAmplicon, szStrand.length(), vSite))
     {
-        if (bvEndonuclease.IsEnzyme(bvEnzymeStrand))    // found enzyme
+        if (vSite[0].count > 0)
+        {
+            trf.push_back(vSite[0].first); prior = vSite[0].last;
+        }   // only the first and the last cuts shape the terminal fragments
+    }
+    else if (pLane)
+    {
+        for (int next = 0; (next = bvEndonuclease.FindEnzyme(*pLane, nAmplicon,
+            szStrand.length(), next)) > 0; )
+        {
+            size = next - bvEndonuclease.GetOffset() - prior;
+            trf.push_back(size); prior += size;
+        }   // search the bit lanes of the amplicon, 64 positions at a time
+    }
+    else
+    {
+        bvEnzymeStrand.SetDigestStrand(bvEndonuclease.GetLength(), szStrand);
+        nEnzymeIndex = bvEndonuclease.GetLength() - 1;      // index starts from 0
+
+        while (nEnzymeIndex < static_cast<int>(szStrand.length()))
         {
-            // calculate the digested fragment sizes
-            size = bvEnzymeStrand.GetDistance() - bvEndonuclease.GetOffset() - prior;
-            trf.push_back(size);          // save the digested fragment size
-            bvEnzymeStrand.Clear();         // reset the bitvector for the next search
-            prior += size;
+            if (bvEndonuclease.IsEnzyme(bvEnzymeStrand))    // found enzyme
+            {
+                // calculate the digested fragment sizes
+                size = bvEnzymeStrand.GetDistance() - bvEndonuclease.GetOffset() - prior;
+                trf.push_back(size);          // save the digested fragment size
+                bvEnzymeStrand.Clear();         // reset the bitvector for the next search
+                prior += size;
 
 #ifdef _VERBOSE
-            cout << "prior: " << prior << endl;
-            cout << " size: " << size << endl;
+                cout << "prior: " << prior << endl;
+                cout << " size: " << size << endl;
 #endif  // _VERBOSE
-        }
+            }
 
-        bvEnzymeStrand.AddNucleotide(szStrand[++nEnzymeIndex]);
-    }   // now, search for the restriction enzymes
+            if (++nEnzymeIndex < static_cast<int>(szStrand.length()))
+            {
+                bvEnzymeStrand.AddNucleotide(szStrand[nEnzymeIndex]);
+            }   // the view ends at the amplicon; no terminating null to roll in
+        }   // now, search for the restriction enzymes
+    }   // roll the bit streams one nucleotide at a time
 
     if (trf.empty())      // full length
     {
@@ -250,22 +342,51 @@ bool cPAT::Digest(
     return(true);         // everything has worked as expected
 }   // end of Digest()
 
+/*
+ * find the sample fragment nearest to the predicted fragment; since the samples are
+ * sorted, only the two fragments around the prediction need to be compared. ties go
+ * to the smaller fragment, and equal fragments to the first one in the sample file.
+ * returns -1 if no fragment is within the window
+*/
+int cPAT::FindSample(
+    const vector<stSAMPLE>& _sample,    // sample fragments sorted by size
+    double  _predict) const            // predicted fragment size
+{
+    stSAMPLE key; key.fragment = _predict;
+    vector<stSAMPLE>::const_iterator i = lower_bound(_sample.begin(), _sample.end(), key, SortSample);
+    double nearest = dForwardBin; int index = -1;
+
+    if (!(i == _sample.end()) && !((*i).fragment - _predict > dForwardBin))
+    {
+        nearest = (*i).fragment - _predict; index = i - _sample.begin();
+    }   // the smallest fragment that is not below the prediction
+
+    if (!(i == _sample.begin()) && !(_predict - (*(i - 1)).fragment > nearest))
+    {
+        key.fragment = (*(i - 1)).fragment;
+        index = lower_bound(_sample.begin(), i, key, SortSample) - _sample.begin();
+    }   // the largest fragment below the prediction, if it is as close
+
+    return(index);
+}   // end of FindSample()
+
 /*
  * match the predicted fragments to the observed fragments in the sample file
 */
 bool cPAT::MatchSample(
-    stNICHE&    _niche)    // the structure for the plausible species
+    stNICHE&    _niche,     // the structure for the plausible species
+    int         _sample)   // which sample?
 {
-    for (list<stSAMPLE>::iterator i = lsSample.begin(); !(i == lsSample.end()); ++i)
+    vector<stSAMPLE>& sample = vSample[_sample];
+    int i = FindSample(sample, _niche.predict);
+
+    if (i < 0)
     {
-        if (!(fabs(_niche.predict - (*i).fragment) > dForwardBin))
-        {
-            _niche.observe = (*i).fragment, _niche.index = i, (*i).count++;
-            return(true);
-        }   // fragments are within the boundary
-    }   // match the predicted and observed fragments
+        return(false);
+    }   // no fragment is within the boundary
 
-    return(false);
+    _niche.observe = sample[i].fragment, _niche.index = i, sample[i].count++;
+    return(true);
 }   // end of MatchSample()
 
 /*
@@ -273,7 +394,7 @@ bool cPAT::MatchSample(
  * separated value (csv) format
 */
 bool cPAT::LoadSample(
-    list<stSAMPLE>& _sample,    // structure of the fragments in the sample
+    vector<stSAMPLE>& _sample,  // structure of the fragments in the sample
     const char*     _name)     // name of the sample file
 {
     ifstream ifs(_name, ios::in);
@@ -309,30 +430,53 @@ bool cPAT::LoadSample(
 #endif  // _VERBOSE
     }   // read the file line by line until eof is encountered
 
+    // sort by the fragment size, keeping the file order among equal fragments
+    stable_sort(_sample.begin(), _sample.end(), SortSample);
+
     ifs.close(); return(true);
 }   // end of LoadSample()
 
+/*
+ * add the fragment counts of another instance that has loaded the same sample file;
+ * every worker counts its own matches, and the counts are added up once all of them
+ * are finished, so that no lock is needed while matching
+*/
+void cPAT::AddCount(
+    const cPAT&     _rflp)     // instance of a worker
+{
+    for (size_t k = 0; (k < vSample.size()) && (k < _rflp.vSample.size()); ++k)
+    {
+        for (size_t i = 0; (i < vSample[k].size()) && (i < _rflp.vSample[k].size()); ++i)
+        {
+            vSample[k][i].count += _rflp.vSample[k][i].count;
+        }   // add the counts of the sample fragments
+    }   // every sample is counted separately
+}   // end of AddCount()
+
 /*
  * normalize the relative abundance
 */
 bool cPAT::SetAbundance(
-    list<stNICHE>&  _niche)    // plausible community structure based on trflp data
+    list<stNICHE>&  _niche,     // plausible community structure based on trflp data
+    int             _sample)   // which sample?
 {
-    if (lsSample.empty() || _niche.empty())
+    vector<stSAMPLE>& sample = vSample[_sample];
+
+    if (sample.empty() || _niche.empty())
     {
         return(false);
     }   // make sure both lists are not empty
 
     double abundance = 0.0;
 
-    for (list<stSAMPLE>::iterator i = lsSample.begin(); !(i == lsSample.end()); ++i)
+    for (vector<stSAMPLE>::iterator i = sample.begin(); !(i == sample.end()); ++i)
     {
         (*i).biomass /= ((*i).count == 0) ? 1.0 : static_cast<double>((*i).count);
     }   // first, normalize the abundance in the sample trflp profile
 
     for (list<stNICHE>::iterator j = _niche.begin(); !(j == _niche.end()); ++j)
     {
-        (*j).biomass = (*(*j).index).biomass; abundance += (*j).biomass;
+        (*j).biomass = sample[(*j).index].biomass; abundance += (*j).biomass;
     }   // now, assign the abundance to the predicted trflp profile
 
     for (list<stNICHE>::iterator k = _niche.begin(); !(k == _niche.end()); ++k)
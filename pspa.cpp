@@ -34,89 +34,116 @@
 // support class implementation
 #include "pspa.h"
 #include "pthread.h"
+#include "seqscan.h"
 
 // force PHP to return immediately
 #define CLOSE_PHP   { fclose(stdin); fclose(stdout); fclose(stderr); };
 
-const unsigned int nMaxTHREAD = 4;
 const unsigned int nMaxBUFFER = 2048;
 
-// define the structure for digest data
+// define the structure for digest data; the counts of a pair of primers
 typedef struct
 {
-    string forward;         // forward primer sequence
-    string reverse;         // reverse primer sequence
     int forward_match;      // number of matches for forward primer
     int reverse_match;      // number of matches for reverse primer
     int primer_match;       // number of matches for both primers
 } stRECORD;
 
 /*
- * non-class implementations
-*/
-/*
- * sort by the forward primer in the ascending order
+ * a primer sequence prevalence analysis; everything the analysis needs is kept in the
+ * job, so that several jobs can share a single scan of the database. the records only
+ * hold the counts of each pair, and the primers of a record are given by its place in
+ * the panel; the pairs are sorted by their places when the job is closed, with the rank
+ * of each primer, its place in the alphabetical order, instead of comparing the strings.
+ *
+ * a primer found without the other primer of a pair is counted once for each length of
+ * the other primer, since the length is all that the outcome depends on. the pairs where
+ * both primers have been found are counted as found by both, 64 sequences at a time with
+ * a population count, and then corrected one by one for the few that are not
 */
-bool SortForwardPrimerA(
-    const stRECORD& _a, const stRECORD& _b)
+typedef struct
 {
-    return(_a.forward < _b.forward);
-}   // end of SortForwardPrimerA()
+    CmdParam cmd;                                   // parameters of the job
+    vector<string> szForward, szReverse;            // primers of the panel
+    vector<int> nForwardClass, nReverseClass;       // length class of each primer
+    vector<int> nForwardLength, nReverseLength;     // primer length of each class
+    vector<unsigned int> uForwardAlone, uReverseAlone;
+    vector<stRECORD> records;       // counts of every pair, forward primer major, f * R + r
+    vector<unsigned int> order;     // places of the pairs in the order of the output
+    pthread_mutex_t mtxLockITEM;    // critical region lock for the merged counts
+} stJOB;
 
 /*
- * sort by the reverse primer in the ascending order
+ * non-class implementations
 */
-bool SortReversePrimerA(
-    const stRECORD& _a, const stRECORD& _b)
-{
-    return(_a.reverse < _b.reverse);
-}   // end of SortReversePrimerA()
-
 /*
- * sort by the number of both primers that has been found in the ascending order
+ * order the pairs of primers by their places in the panel, f * R + r, as chosen by the
+ * sort option of the parameter file
 */
-bool SortPrimerMatchA(
-    const stRECORD& _a, const stRECORD& _b)
+class   SortOption
 {
-    return(_a.primer_match < _b.primer_match);
-}   // end of SortPrimerMatchA()
+public:
+    SortOption(const stJOB& _job, const vector<int>& _forward, const vector<int>& _reverse) :
+        vRecord(_job.records), nForwardRank(_forward), nReverseRank(_reverse),
+        nReverse(_job.szReverse.size()), nOption(_job.cmd.SortOption()) {};
 
-/*
- * sort by the forward primer in the descending order
-*/
-bool SortForwardPrimerD(
-    const stRECORD& _a, const stRECORD& _b)
-{
-    return(_a.forward > _b.forward);
-}   // end of SortForwardPrimerD()
+    bool operator()(unsigned int _a, unsigned int _b) const
+    {
+        switch (nOption)
+        {
+            case 0:     // sort by forward primers in ascending order
+                return(nForwardRank[_a / nReverse] < nForwardRank[_b / nReverse]);
+            case 1:     // sort by reverse primers in ascending order
+                return(nReverseRank[_a % nReverse] < nReverseRank[_b % nReverse]);
+            case 2:     // sort by number of both primers matches in ascending order
+                return(vRecord[_a].primer_match < vRecord[_b].primer_match);
+            case 3:     // sort by forward primers in descending order
+                return(nForwardRank[_a / nReverse] > nForwardRank[_b / nReverse]);
+            case 4:     // sort by reverse primers in descending order
+                return(nReverseRank[_a % nReverse] > nReverseRank[_b % nReverse]);
+            default:    // sort by number of primer matches in descending order
+                return(vRecord[_a].primer_match > vRecord[_b].primer_match);
+        }   // the sort option of the parameter file
+    }
 
-/*
- * sort by the reverse primer in the descending order
-*/
-bool SortReversePrimerD(
-    const stRECORD& _a, const stRECORD& _b)
-{
-    return(_a.reverse > _b.reverse);
-}   // end of SortReversePrimerD()
+private:
+    const vector<stRECORD>& vRecord;    // counts of every pair
+    const vector<int>& nForwardRank;    // place of each forward primer in the alphabetical order
+    const vector<int>& nReverseRank;    // place of each reverse primer in the alphabetical order
+    size_t nReverse;                    // number of reverse primers
+    int nOption;                        // sort option of the parameter file
+};  // end of class definition for SortOption
 
 /*
- * sort by the number of both primers that has been found in the descending order
+ * rank the primers in the alphabetical order; identical primers share the same rank
 */
-bool SortPrimerMatchD(
-    const stRECORD& _a, const stRECORD& _b)
+void RankPrimer(
+    const vector<string>&   _primer,    // primer sequences
+    vector<int>&            _rank)     // rank of each primer
 {
-    return(_a.primer_match > _b.primer_match);
-}   // end of SortPrimerMatchD()
+    vector<pair<string, int> > order;
+
+    for (unsigned int i = 0; i < _primer.size(); ++i)
+    {
+        order.push_back(make_pair(_primer[i], i));
+    }
+
+    sort(order.begin(), order.end()); _rank.assign(_primer.size(), 0);
+
+    for (unsigned int i = 1; i < order.size(); ++i)
+    {
+        _rank[order[i].second] = _rank[order[i - 1].second] + !(order[i].first == order[i - 1].first);
+    }
+}   // end of RankPrimer()
 
 /*
  * write the output in the plain text format
  * format: forward primer, reverse primer, matches
 */
 bool WriteTXT(
-    list<stRECORD>& _lst,   // fragment data storage
-    CmdParam&       _cmd)  // command-line parameters
+    stJOB&  _job)  // records, primers, and parameters of the job
 {
-    string name = _cmd.GetFilename();
+    string name = _job.cmd.GetFilename();
     name += ".txt";             // add an extension
     ofstream ofs(name.c_str(), ios::trunc);
     char buffer[nMaxBUFFER];
@@ -126,20 +153,23 @@ bool WriteTXT(
         return(false);
     }   // file cannot be opened or created successfully
 
-    ofs << "Query allowed at most " << _cmd.Mismatch() << " mismatches within ";
-    ofs << _cmd.MaxBase() << " bases from 5\' end of primer." << endl << endl;
+    ofs << "Query allowed at most " << _job.cmd.Mismatch() << " mismatches within ";
+    ofs << _job.cmd.MaxBase() << " bases from 5\' end of primer." << endl << endl;
     ofs << "Forward Primer            Forward Matches Reverse Primer            ";
     ofs <<" Reverse Matches Both Matches" << endl;
 
-    for (list<stRECORD>::iterator i = _lst.begin(); !(i == _lst.end()); ++i)
+    size_t nr = _job.szReverse.size();
+
+    for (vector<unsigned int>::iterator i = _job.order.begin(); !(i == _job.order.end()); ++i)
     {
+        const stRECORD& k = _job.records[*i];
         sprintf(buffer, "%25s %15d %25s %15d %12d",
-            (*i).forward.c_str(),     // forward primer sequence
-            (*i).forward_match,       // number of forward primer amplified sequences
-            (*i).reverse.c_str(),     // reverse primer sequence
-            (*i).reverse_match,       // number of reverse primer amplified sequences
-            (*i).primer_match);      // number of sequences amplified by both primers
-        ofs << buffer << endl;
+            _job.szForward[*i / nr].c_str(),    // forward primer sequence
+            k.forward_match,        // number of forward primer amplified sequences
+            _job.szReverse[*i % nr].c_str(),    // reverse primer sequence
+            k.reverse_match,        // number of reverse primer amplified sequences
+            k.primer_match);       // number of sequences amplified by both primers
+        ofs << buffer << '\n';
     }   // iterate through the entire list and print out the contents
 
     ofs.close(); return(true);
@@ -150,10 +180,9 @@ bool WriteTXT(
  * write all fragments
 */
 bool WriteCSV(
-    list<stRECORD>& _lst,   // fragment data storage
-    CmdParam&       _cmd)  // command-line parameters
+    stJOB&  _job)  // records, primers, and parameters of the job
 {
-    string name = _cmd.GetFilename();
+    string name = _job.cmd.GetFilename();
     name += ".csv";             // add an extension
     ofstream ofs(name.c_str(), ios::trunc);
 
@@ -162,14 +191,17 @@ bool WriteCSV(
         return(false);
     }   // file cannot be opened or created successfully
 
-    ofs << "\"Query allowed at most " << _cmd.Mismatch() << " mismatches within ";
-    ofs << _cmd.MaxBase() << " bases from 5\' end of primer.\"" << endl << endl;
+    ofs << "\"Query allowed at most " << _job.cmd.Mismatch() << " mismatches within ";
+    ofs << _job.cmd.MaxBase() << " bases from 5\' end of primer.\"" << endl << endl;
+
+    size_t nr = _job.szReverse.size();
 
-    for (list<stRECORD>::iterator i = _lst.begin(); !(i == _lst.end()); ++i)
+    for (vector<unsigned int>::iterator i = _job.order.begin(); !(i == _job.order.end()); ++i)
     {
-        ofs << "\"" << (*i).forward << "\"," << (*i).forward_match;
-        ofs << ",\"" << (*i).reverse << "\"," << (*i).reverse_match;
-        ofs << "," << (*i).primer_match << endl;
+        const stRECORD& k = _job.records[*i];
+        ofs << "\"" << _job.szForward[*i / nr] << "\"," << k.forward_match;
+        ofs << ",\"" << _job.szReverse[*i % nr] << "\"," << k.reverse_match;
+        ofs << "," << k.primer_match << '\n';
     }   // iterate through the entire list and print out the contents
 
     ofs.close(); return(true);
@@ -180,10 +212,9 @@ bool WriteCSV(
  * interface for display, write all fragments
 */
 bool WriteDAT(
-    list<stRECORD>& _lst,       // fragment data storage
-    CmdParam&       _cmd)      // command-line parameters
+    stJOB&  _job)  // records, primers, and parameters of the job
 {
-    string name = _cmd.GetFilename();
+    string name = _job.cmd.GetFilename();
     name += ".dat";             // add and extension
     ofstream ofs(name.c_str(), ios::trunc);
 
@@ -192,11 +223,14 @@ bool WriteDAT(
         return(false);
     }   // file cannot be opened or created successfully
 
-    for (list<stRECORD>::iterator i = _lst.begin(); !(i == _lst.end()); ++i)
+    size_t nr = _job.szReverse.size();
+
+    for (vector<unsigned int>::iterator i = _job.order.begin(); !(i == _job.order.end()); ++i)
     {
-        ofs << "\"" << (*i).forward << "\"," << (*i).forward_match;
-        ofs << ",\"" << (*i).reverse << "\"," << (*i).reverse_match;
-        ofs << "," << (*i).primer_match << endl;
+        const stRECORD& k = _job.records[*i];
+        ofs << "\"" << _job.szForward[*i / nr] << "\"," << k.forward_match;
+        ofs << ",\"" << _job.szReverse[*i % nr] << "\"," << k.reverse_match;
+        ofs << "," << k.primer_match << '\n';
     }   // iterate through the entire list and print out the contents
 
     ofs.close(); return(true);
@@ -206,10 +240,9 @@ bool WriteDAT(
  * draw the output in PHP format for web display
 */
 bool WritePHP(
-    list<stRECORD>& _lst,       // fragment data storage
-    CmdParam&       _cmd)      // command-line parameters
+    stJOB&  _job)  // records, primers, and parameters of the job
 {
-    string name = _cmd.GetFilename();
+    string name = _job.cmd.GetFilename();
     name += ".php";             // add and extension
     ofstream ofs(name.c_str(), ios::trunc);
 
@@ -221,144 +254,406 @@ bool WritePHP(
     ofs << "<?php" << endl;
     ofs << "  require \"shared.data.inc\";" << endl;
     ofs << "  DrawHeader(\"MiCA: Primer Sequence Prevalence Anlysis Output\");" << endl;
-    ofs << "  DrawPSPA(" << _cmd.GetFilename() << ");" << endl;
+    ofs << "  DrawPSPA(" << _job.cmd.GetFilename() << ");" << endl;
     ofs << "  DrawFooter();" << endl << "?>" << endl;
 
     ofs.close(); return(true);
 }   // end of WritePHP()
 
-// globally accessible classes for multithreading
-CmdParam cmd; SeqDB rdp;
-list<stRECORD> data;
-pthread_mutex_t mtxLockDBMS;    // critical region lock for database
-pthread_mutex_t mtxLockITEM;    // critical region lock for records
+/*
+ * hits of a block of up to 64 sequences, one bit for each sequence
+*/
+typedef struct
+{
+    int count;                          // number of sequences in the block
+    vector<uint64_t> forward, reverse;  // sequences where the primer has been found
+    vector<uint64_t> fpass, rpass;      // and found on its own, for each length class
+} stBLOCK;
 
 /*
- * the prodcution pspa function
+ * the state of a worker; the primers found on their own are counted by the worker, and
+ * merged into the job only once, after the database is exhausted
 */
-void* DoPSPA(void*)
+typedef struct
 {
-    cPSPA pspa(cmd);          // initialize the class
-    vector<bool> forward, reverse;
-    unsigned int idx;
-    bool run = false;
+    cPSPA* pspa;                                // class of the worker
+    vector<unsigned int> forward, reverse;      // primers found on their own
+    vector<int> fidx, ridx, rlength, rstart;    // the primers found in the sequence
+    stBLOCK block;
+} stWORKER;
 
-    do
-    {
-        pthread_mutex_lock(&mtxLockDBMS);
-        // ** enter the critical section for database
-        run = rdp.NextRecord();     // retrive a sequence from the database
+/*
+ * add the pairs of a block to the records; every pair found by both primers in a sequence
+ * adds one to each count, less the sequences already counted for the primer on its own
+*/
+void FlushBlock(
+    stJOB&      _job,       // the job
+    stBLOCK&    _block)    // hits of the block
+{
+    size_t nf = _job.szForward.size(), nr = _job.szReverse.size();
+    size_t cf = _job.nForwardLength.size(), cr = _job.nReverseLength.size();
+    vector<unsigned int> ridx;
 
-        if (run)
+    for (size_t j = 0; j < nr; ++j)
+    {
+        if (_block.reverse[j])
         {
-            pspa.SetStrand(rdp.GetOrigin());
-        }   // set the sequence for the search
-        // ** leave the critical section for database
-        pthread_mutex_unlock(&mtxLockDBMS);
+            ridx.push_back(j);
+        }
+    }   // only the reverse primers found in the block
 
-        if (!run)
+    for (size_t i = 0; i < nf; ++i)
+    {
+        for (size_t n = 0; _block.forward[i] && (n < ridx.size()); ++n)
         {
-            continue;
-        }   // skip if there is no more sequences
+            size_t j = ridx[n];
+            uint64_t both = _block.forward[i] & _block.reverse[j];
+
+            if (!both)
+            {
+                continue;
+            }   // the two primers are never found in the same sequence
 
-        forward.clear(); reverse.clear();
-        pspa.Delimit(forward, reverse);   // perform the search on all primers
-        idx = 0;
+            stRECORD& k = _job.records[i * nr + j]; int count = CountBits(both);
+            int f = count - CountBits(_block.fpass[i * cr + _job.nReverseClass[j]] & _block.reverse[j]);
+            int r = count - CountBits(_block.rpass[j * cf + _job.nForwardClass[i]] & _block.forward[i]);
 
-        pthread_mutex_lock(&mtxLockITEM);
-        // ** enter the critical section for records
-        for (list<stRECORD>::iterator k = data.begin(); !(k == data.end()); ++k, ++idx)
-        {
-            (*k).forward_match += static_cast<int>(forward[idx]);
-            (*k).reverse_match += static_cast<int>(reverse[idx]);
+            if (f)
+            {
+                __atomic_fetch_add(&k.forward_match, f, __ATOMIC_RELAXED);
+            }
 
-            if (forward[idx] && reverse[idx])
+            if (r)
             {
-                (*k).primer_match += 1;
-            }   // calculate the number of simultaneous matches
-        }   // record the digestions
-        // ** leave the critical section for database
-        pthread_mutex_unlock(&mtxLockITEM);
-    } while (run);
+                __atomic_fetch_add(&k.reverse_match, r, __ATOMIC_RELAXED);
+            }
+
+            __atomic_fetch_add(&k.primer_match, count, __ATOMIC_RELAXED);
+        }
+    }   // the workers share the records, so the counts are added atomically
 
-    return(NULL);
-}   // end of DoPSPA()
+    fill(_block.forward.begin(), _block.forward.end(), 0);
+    fill(_block.reverse.begin(), _block.reverse.end(), 0);
+    fill(_block.fpass.begin(), _block.fpass.end(), 0);
+    fill(_block.rpass.begin(), _block.rpass.end(), 0);
+    _block.count = 0;
+}   // end of FlushBlock()
 
 /*
- * to compile, type:
- * g++ cmdparam.cpp seqdb.cpp bitvector.cpp ispar.cpp -o ispar.exe
+ * sort the primers into classes by their lengths
 */
-int main(int argc, char** argv)
+void ClassifyPrimer(
+    const vector<string>&   _primer,    // primer sequences
+    vector<int>&            _class,     // length class of each primer
+    vector<int>&            _length)   // primer length of each class
 {
-    if (argc < 2) {
-        cout << "insufficient number of parameters" << endl;
-        return(1);
+    _class.clear(); _length.clear();
+
+    for (unsigned int i = 0; i < _primer.size(); ++i)
+    {
+        int length = _primer[i].length();
+        int c = find(_length.begin(), _length.end(), length) - _length.begin();
+
+        if (c == static_cast<int>(_length.size()))
+        {
+            _length.push_back(length);
+        }   // first primer of this length
+
+        _class.push_back(c);
     }
+}   // end of ClassifyPrimer()
 
-    cmd.OpenFile(argv[1]);              // open the parameter file
-    rdp.OpenFile(cmd.GetDatabase());      // open the sequence database
-    data.clear(); stRECORD item;
+/*
+ * read the parameter file and set up the job
+*/
+void* OpenJob(
+    const char* _param)    // parameter file
+{
+    stJOB* job = new stJOB; stJOB& j = *job;
 
-    for (unsigned int f = 0; f < cmd.ForwardPrimerCount(); ++f)
+    if (!j.cmd.OpenFile(_param))
     {
-        for (unsigned int r = 0; r < cmd.ReversePrimerCount(); ++r)
-        {
-            item.forward = cmd.GetForwardPrimer(f);
-            item.reverse = cmd.GetReversePrimer(r);
-            item.forward_match = item.reverse_match = item.primer_match = 0;
-            data.push_back(item);
+        delete job; return(0);
+    }   // open the parameter file; every primer must fit into the bit streams
+
+    j.szForward.assign(j.cmd.ForwardPrimerList().begin(), j.cmd.ForwardPrimerList().end());
+    j.szReverse.assign(j.cmd.ReversePrimerList().begin(), j.cmd.ReversePrimerList().end());
+    ClassifyPrimer(j.szForward, j.nForwardClass, j.nForwardLength);
+    ClassifyPrimer(j.szReverse, j.nReverseClass, j.nReverseLength);
+    j.uForwardAlone.assign(j.szForward.size() * j.nReverseLength.size(), 0);
+    j.uReverseAlone.assign(j.szReverse.size() * j.nForwardLength.size(), 0);
+
+    stRECORD item; item.forward_match = item.reverse_match = item.primer_match = 0;
+    j.records.assign(j.szForward.size() * j.szReverse.size(), item);   // one for each pair
 
 #ifdef _VERBOSE
-            cout << "forward primer: " << item.forward << endl;
-            cout << "reverse primer: " << item.reverse << endl;
+    for (unsigned int f = 0; f < j.szForward.size(); ++f)
+    {
+        cout << "forward primer: " << j.szForward[f] << endl;
+    }
+
+    for (unsigned int r = 0; r < j.szReverse.size(); ++r)
+    {
+        cout << "reverse primer: " << j.szReverse[r] << endl;
+    }
 #endif  // _VERBOSE
-        }
-    }   // construct and initialize the records
 
-    pthread_mutex_init(&mtxLockDBMS, NULL);   // initialize the lock for database
-    pthread_mutex_init(&mtxLockITEM, NULL);   // initialize the lock for record
-    vector<pthread_t> pts(nMaxTHREAD, 0);     // a vector for pthread
+    pthread_mutex_init(&j.mtxLockITEM, NULL);   // initialize the lock for record
+    return(job);
+}   // end of OpenJob()
+
+/*
+ * parameters of the job
+*/
+CmdParam& JobParam(
+    void* _job)
+{
+    return(static_cast<stJOB*>(_job)->cmd);
+}   // end of JobParam()
+
+/*
+ * set up the class and the counters of a worker
+*/
+void* StartWorker(
+    void* _job)
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+    stWORKER* worker = new stWORKER;
+    size_t nf = job.szForward.size(), nr = job.szReverse.size();
+    size_t cf = job.nForwardLength.size(), cr = job.nReverseLength.size();
+
+    worker->pspa = new cPSPA(job.cmd);  // initialize the class
+    worker->forward.assign(nf * cr, 0); worker->reverse.assign(nr * cf, 0);
+
+    stBLOCK& block = worker->block;
+    block.count = 0;
+    block.forward.assign(nf, 0); block.reverse.assign(nr, 0);
+    block.fpass.assign(nf * cr, 0); block.rpass.assign(nr * cf, 0);
+    return(worker);
+}   // end of StartWorker()
+
+/*
+ * the prodcution pspa function
+*/
+void ScanBatch(
+    void*       _job,       // the job
+    void*       _worker,    // state of the worker
+    stBATCH*    _batch)    // records to be analyzed
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+    stWORKER& worker = *static_cast<stWORKER*>(_worker);
+    cPSPA& pspa = *worker.pspa; stBLOCK& block = worker.block;
+    const vector<string>& szForward = job.szForward;
+    const vector<string>& szReverse = job.szReverse;
+    const vector<int>& nForwardLength = job.nForwardLength;
+    const vector<int>& nReverseLength = job.nReverseLength;
+    size_t nf = szForward.size(), nr = szReverse.size();
+    size_t cf = nForwardLength.size(), cr = nReverseLength.size();
+    vector<unsigned int>& forward = worker.forward;
+    vector<unsigned int>& reverse = worker.reverse;
+    vector<int>& fidx = worker.fidx; vector<int>& ridx = worker.ridx;
+    vector<int>& rlength = worker.rlength; vector<int>& rstart = worker.rstart;
+    stDELIMIT range; int length;
+
+    for (int n = 0; n < _batch->count; ++n)
+    {
+        stSEQUENCE& seq = _batch->records[n];
+
+        if (!pspa.SetStrand(seq.origin, &seq.lanes))
+        {
+            continue;
+        }   // skip if the sequence is empty
+
+        pspa.Delimit(); length = pspa.GetLength();   // perform the search on all primers
+        const vector<int>& tf = pspa.GetForwardHit();
+        const vector<int>& tr = pspa.GetReverseHit();
+        uint64_t bit = static_cast<uint64_t>(1) << block.count;
+        fidx.clear(); ridx.clear(); rlength.clear(); rstart.clear();
+
+        for (size_t i = 0; i < nf; ++i)
+        {
+            if (tf[i] < 0)
+            {
+                continue;
+            }
+
+            for (size_t c = 0; c < cr; ++c)
+            {
+                BitLane::Pair(length, szForward[i].length(), nReverseLength[c], tf[i], -1, range);
+                forward[i * cr + c] += range.bForward;
+                block.fpass[i * cr + c] |= (range.bForward) ? bit : 0;
+            }
+
+            fidx.push_back(i); block.forward[i] |= bit;
+        }   // the forward primers found, with none of the reverse primers
+
+        for (size_t j = 0; j < nr; ++j)
+        {
+            if (tr[j] < 0)
+            {
+                continue;
+            }
+
+            for (size_t c = 0; c < cf; ++c)
+            {
+                BitLane::Pair(length, nForwardLength[c], szReverse[j].length(), -1, tr[j], range);
+                reverse[j * cf + c] += range.bReverse;
+                block.rpass[j * cf + c] |= (range.bReverse) ? bit : 0;
+            }
+
+            ridx.push_back(j); block.reverse[j] |= bit;
+            rlength.push_back(szReverse[j].length()); rstart.push_back(tr[j]);
+        }   // the reverse primers found, with none of the forward primers
+
+        for (size_t a = 0; a < fidx.size(); ++a)
+        {
+            int i = fidx[a], lf = szForward[i].length();
+
+            for (size_t b = 0; b < ridx.size(); ++b)
+            {
+                if (BitLane::Pair(length, lf, rlength[b], tf[i], rstart[b], range))
+                {
+                    continue;
+                }   // counted by FlushBlock()
+
+                stRECORD& k = job.records[i * nr + ridx[b]];
+                __atomic_fetch_sub(&k.forward_match, !range.bForward, __ATOMIC_RELAXED);
+                __atomic_fetch_sub(&k.reverse_match, !range.bReverse, __ATOMIC_RELAXED);
+                __atomic_fetch_sub(&k.primer_match, 1, __ATOMIC_RELAXED);
+            }
+        }   // the pairs where both primers have been found, but not both delimit
+
+        if (++block.count == nMaxWORD_WIDTH)
+        {
+            FlushBlock(job, block);
+        }   // one bit for each sequence of the block
+    }   // process every record of the batch
+}   // end of ScanBatch()
+
+/*
+ * merge the counts of a worker into the job
+*/
+void StopWorker(
+    void*   _job,       // the job
+    void*   _worker)   // state of the worker
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+    stWORKER* worker = static_cast<stWORKER*>(_worker);
+
+    if (worker->block.count > 0)
+    {
+        FlushBlock(job, worker->block);
+    }   // the last block may be partial
 
-    for (unsigned int i = 0; i < pts.size(); ++i)
+    pthread_mutex_lock(&job.mtxLockITEM);
+    // ** enter the critical section for the merged counts
+    for (size_t k = 0; k < worker->forward.size(); ++k)
     {
-        pthread_create(&pts[i], NULL, &DoPSPA, NULL);
-    }   // first, spawn the threads
+        job.uForwardAlone[k] += worker->forward[k];
+    }
 
-    for (unsigned int j = 0; j < pts.size(); ++j)
+    for (size_t k = 0; k < worker->reverse.size(); ++k)
     {
-        pthread_join(pts[j], NULL);
-    }   // wait for all threads to complete
+        job.uReverseAlone[k] += worker->reverse[k];
+    }
+    // ** leave the critical section for the merged counts
+    pthread_mutex_unlock(&job.mtxLockITEM);
+
+    delete worker->pspa; delete worker;
+}   // end of StopWorker()
+
+/*
+ * complete the counts, sort the records, and write the outputs; returns false if an
+ * output cannot be written
+*/
+bool CloseJob(
+    void* _job)
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+    vector<stRECORD>& records = job.records;
+    size_t nf = job.szForward.size(), nr = job.szReverse.size();
+    size_t cf = job.nForwardLength.size(), cr = job.nReverseLength.size();
+    vector<int> nForwardRank, nReverseRank;
+
+    for (size_t f = 0; f < nf; ++f)
+    {
+        for (size_t r = 0; r < nr; ++r)
+        {
+            records[f * nr + r].forward_match += job.uForwardAlone[f * cr + job.nReverseClass[r]];
+            records[f * nr + r].reverse_match += job.uReverseAlone[r * cf + job.nForwardClass[f]];
+        }
+    }   // add the counts of the primers found on their own
 
 #ifdef _VERBOSE
-    for (list<stRECORD>::iterator d = data.begin(); !(d == data.end()); ++d)
+    for (size_t d = 0; d < records.size(); ++d)
     {
-        cout << (*d).forward << ", " << (*d).forward_match << ", ";
-        cout << (*d).reverse << ", " << (*d).reverse_match << ", ";
-        cout << (*d).primer_match << endl;
+        cout << job.szForward[d / nr] << ", " << records[d].forward_match << ", ";
+        cout << job.szReverse[d % nr] << ", " << records[d].reverse_match << ", ";
+        cout << records[d].primer_match << endl;
     }   // print out the content of list
 #endif  // _VERBOSE
 
-    bool (*SortOption[6])(const stRECORD&, const stRECORD&) =
+    RankPrimer(job.szForward, nForwardRank); RankPrimer(job.szReverse, nReverseRank);
+    job.order.resize(records.size());
+
+    for (size_t d = 0; d < records.size(); ++d)
     {
-        SortForwardPrimerA, // sort by forward primers in ascending order
-        SortReversePrimerA, // sort by reverse primers in ascending order
-        SortPrimerMatchA,   // sort by number of both primers matches in ascending order
-        SortForwardPrimerD, // sort by reverse primers in descending order
-        SortReversePrimerD, // sort by reverse primers in descending order
-        SortPrimerMatchD    // sort by number of primer matches in descending order
-    };  // nasty function pointers
+        job.order[d] = d;
+    }   // the pairs in the order of the panel
 
-    data.sort(*SortOption[cmd.SortOption()]);   // sort the output data
+    // sort the output data; the order of the equal records is kept, as list::sort() did
+    stable_sort(job.order.begin(), job.order.end(), SortOption(job, nForwardRank, nReverseRank));
 
     /*
      * write the output in various formats; explicitly signal the compiler that these
      * funcation calls do not require any specific order. the compiler is free to
      * rearrange for processor dispatch and parallel processing.
     */
-    WriteTXT(data, cmd), WriteCSV(data, cmd), WriteDAT(data, cmd), WritePHP(data, cmd);
+    bool written = WriteTXT(job) & WriteCSV(job) & WriteDAT(job) & WritePHP(job);
+
+    pthread_mutex_destroy(&job.mtxLockITEM);
+    delete &job;
+    return(written);
+}   // end of CloseJob()
+
+// the hooks of the analysis into the database scan
+const stANALYSIS stAnalysis =
+{
+    "pspa", OpenJob, JobParam, StartWorker, ScanBatch, StopWorker, CloseJob
+};
+
+/*
+ * to compile, type:
+ * g++ -std=c++17 -O3 -I. bitvector.cpp cmdparam.cpp seqdb.cpp threadpool.cpp seqqueue.cpp
+ *     seqscan.cpp pspa.cpp -o pspa -lpthread
+*/
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        cout << "insufficient number of parameters" << endl;
+        return(1);
+    }
+
+    void* job = OpenJob(argv[1]);       // open the parameter file
+
+    if (!job)
+    {
+        return(1);
+    }   // the parameter file cannot be used
+
+    CmdParam& cmd = JobParam(job);
+
+    if (argc > 2)
+    {
+        cmd.SetThreads(atoi(argv[2]));
+    }   // the number of threads on the command line overrides the parameter file
+
+    bool scanned = ScanDatabase(cmd.GetDatabase(), cmd.Threads(), vector<stQUERY>(1, { &stAnalysis, job }));
+
+    if (!CloseJob(job) || !scanned)
+    {
+        return(1);
+    }   // the database cannot be read, or an output cannot be written
 
-    pthread_exit(NULL);
-    pthread_mutex_destroy(&mtxLockITEM);
-    pthread_mutex_destroy(&mtxLockDBMS);
     return(0);
 }   // end of main()
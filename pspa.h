@@ -30,6 +30,8 @@
  * All rights reserved. Copyrights (R) 2005.
  * last updated on April 28, 2005
  * last revised on July 10, 2007
+ * searched each primer once per sequence on October 18, 2026
+ * searched the primers as a panel for thousands of primers on October 18, 2026
 */
 #ifndef _PSPA_H
 #define _PSPA_H
@@ -61,19 +63,22 @@ public:
     cPSPA(CmdParam&);
     ~cPSPA() {};
 
-    bool SetStrand(const string&);
-    int Delimit(vector<bool>&, vector<bool>&);    // delimit sequences with two primers
+    bool SetStrand(string_view, const BitLane* = 0);
+    int Delimit();              // search the sequence for every primer
     void PrintStrand() const    { cout << szStrand; }
 
+    int GetLength() const       { return(szStrand.length()); }
+    const vector<int>& GetForwardHit() const    { return(vForwardHit); }
+    const vector<int>& GetReverseHit() const    { return(vReverseHit); }
+
 private:
     // binary representations for the primers and restriction enzymes
-    bool bForwardFound, bReverseFound;
-    BitVector bvForwardStrand, bvReverseStrand;
-    list<BitVector> bvForwardPrimer, bvReversePrimer;
-
-    string szStrand;
+    const BitLane* pLane;       // bit lanes of the sequence
+    BitLane blStrand;           // bit lanes expanded here if the database has none
+    BitPanel bpForwardPrimer, bpReversePrimer;
+    vector<int> vForwardHit, vReverseHit;   // hits of each primer in the sequence
 
-    bool Search(list<BitVector>::iterator, list<BitVector>::iterator);
+    string_view szStrand;       // view of the record
 };  // end of class definition for cPSPA
 
 /*
@@ -81,43 +86,46 @@ private:
  * setup the bit patterns for forward and reverse primers
 */
 cPSPA::cPSPA(
-    CmdParam& _cmd)    // command-line parameters
+    CmdParam& _cmd) :  // command-line parameters
+    bpForwardPrimer(true), bpReversePrimer(false)
 {
-    BitVector forward, reverse;
-    bvForwardPrimer.assign(_cmd.ForwardPrimerCount(), forward);
-    bvReversePrimer.assign(_cmd.ReversePrimerCount(), reverse);
-    int fidx = 0; int ridx = 0;
+    BitVector primer;
 
-    for (list<BitVector>::iterator f = bvForwardPrimer.begin();
-        !(f == bvForwardPrimer.end()); ++f, ++fidx)
+    for (list<string>::const_iterator f = _cmd.ForwardPrimerList().begin();
+        !(f == _cmd.ForwardPrimerList().end()); ++f)
     {
-        (*f).SetMismatch(_cmd.Mismatch(), _cmd.MaxBase());
-        (*f).SetForwardPrimer(_cmd.GetForwardPrimer(fidx));
+        primer.SetMismatch(_cmd.Mismatch(), _cmd.MaxBase());
+        primer.SetForwardPrimer(*f); bpForwardPrimer.AddPrimer(primer);
 
 #ifdef _VERBOSE
-        cout << "forward primer:" << endl; (*f).Print();
+        cout << "forward primer:" << endl; primer.Print();
 #endif  // _VERBOSE
     }   // convert the forward primers into bit streams
 
-    for (list<BitVector>::iterator r = bvReversePrimer.begin();
-        !(r == bvReversePrimer.end()); ++r, ++ridx)
+    for (list<string>::const_iterator r = _cmd.ReversePrimerList().begin();
+        !(r == _cmd.ReversePrimerList().end()); ++r)
     {
-        (*r).SetMismatch(_cmd.Mismatch(), _cmd.MaxBase());
-        (*r).SetReversePrimer(_cmd.GetReversePrimer(ridx));
+        primer.SetMismatch(_cmd.Mismatch(), _cmd.MaxBase());
+        primer.SetReversePrimer(*r); bpReversePrimer.AddPrimer(primer);
 
 #ifdef _VERBOSE
-        cout << "reverse primer:" << endl; (*r).Print();
+        cout << "reverse primer:" << endl; primer.Print();
 #endif  // _VERBOSE
     }
+
+    bpForwardPrimer.Compile(); bpReversePrimer.Compile();
 }   // end of class constructor
 
 /*
- * set the sequence to be searched
+ * set the sequence to be searched; the primers are always searched in the bit lanes, so
+ * the sequence is expanded here when the database does not supply them
 */
 bool cPSPA::SetStrand(
-    const string& _s)
+    string_view     _s,         // sequence to be searched
+    const BitLane*  _lane)     // bit lanes of the sequence, if available
 {
     szStrand = _s;
+    pLane = (_lane && (_lane->GetLength() == static_cast<int>(_s.length()))) ? _lane : 0;
 
     if (!(szStrand.length() > 0))
     {
@@ -128,77 +136,24 @@ bool cPSPA::SetStrand(
     cout << "szStrand: " << szStrand << endl;
 #endif
 
+    if (!pLane)
+    {
+        blStrand.Encode(szStrand); pLane = &blStrand;
+    }   // expand the sequence into the bit lanes
+
     return(true);
 }   // end of SetStran()
 
 /*
- * search for the forward and reverse primers
+ * find the first hit of every forward primer and the last hit of every reverse primer;
+ * each panel is searched in a single pass over the sequence. the outcome of a pair, which
+ * is what the interleaved search of the two primers would have found, is then worked out
+ * from the two hits with BitLane::Pair(). returns the number of primers found
 */
-bool cPSPA::Search(
-    list<BitVector>::iterator   _fp,    // iterator of the forward primer
-    list<BitVector>::iterator   _rp)   // iterator of the reverse primer
+int cPSPA::Delimit()
 {
-    int forward, reverse;
-
-    // convert sequence into bit streams for forward primer search
-    bvForwardStrand.SetForwardStrand((*_fp).GetLength(), szStrand);
-    forward = (*_fp).GetLength() - 1;
-
-#ifdef _VERBOSE
-    cout << "forward strand:" << endl; bvForwardStrand.Print();
-#endif  // _VERBOSE
-
-    bvReverseStrand.SetReverseStrand((*_rp).GetLength(), szStrand);
-    reverse = szStrand.length() - (*_rp).GetLength();
-
-#ifdef _VERBOSE
-    cout << "reverse strand:" << endl; bvReverseStrand.Print();
-#endif  // _VERBOSE
-
-    bForwardFound = bReverseFound = false;
-
-    while (forward < reverse)
-    {
-        if (!bForwardFound)
-        {
-            bForwardFound = (*_fp).IsPrimer(bvForwardStrand);
-            bvForwardStrand.AddNucleotide(szStrand[++forward]);
-        }   // search for the forward primer
-
-        if (!bReverseFound)
-        {
-            bReverseFound = (*_rp).IsPrimer(bvReverseStrand);
-            bvReverseStrand.AddNucleotide(szStrand[--reverse]);
-        }   // search for the reverse primer
-
-        if (bForwardFound && bReverseFound)
-        {
-            return(true);
-        }   // both primer must be found
-    }   // search for the forward and reverse primer
-
-    return(false);
-}   // end of Search()
-
-/*
- * restrict the sequences with two primers
-*/
-int cPSPA::Delimit(
-    vector<bool>&   _f,     // indicate if the forward primer has been found
-    vector<bool>&   _r)    // indicate if the reverse primer has been found
-{
-    for (list<BitVector>::iterator i = bvForwardPrimer.begin();
-        !(i == bvForwardPrimer.end()); ++i)
-    {
-        for (list<BitVector>::iterator j = bvReversePrimer.begin();
-            !(j == bvReversePrimer.end()); ++j)
-        {
-            Search(i, j);     // search for the forward and reverse primers
-            _f.push_back(bForwardFound), _r.push_back(bReverseFound);
-        }
-    }   // iterate through the entire lists of forward and reverse primers
-
-    return(_f.size());
+    return(bpForwardPrimer.Search(*pLane, vForwardHit) +
+        bpReversePrimer.Search(*pLane, vReverseHit));
 }   // end of Delimit()
 
 #endif  // _PSPA_H
@@ -0,0 +1,247 @@
+/*
+ * SEEDINDEX.CPP
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#include <seedindex.h>
+
+#include <cstring>
+#include <fcntl.h>
+#include <climits>
+#include <algorithm>
+#include <iostream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif  // _WIN32
+
+// for debugging purpose
+//#define _VERBOSE
+
+/*
+ * map the seed index named in the parameter file and collect the windows of every record
+ * where the primers may match. returns false if there is no index, or it cannot be used;
+ * the sequences are then searched for the primers instead
+*/
+bool SeedIndex::Open(
+    CmdParam& _cmd)    // command-line parameters
+{
+    Close();
+
+#ifdef _WIN32
+    return(false);      // memory mapping is only supported on posix systems
+#else
+    struct stat info, st; stSEEDHEADER header; void* map; int fd;
+
+    if (!(*_cmd.GetSeedIndex()) || (stat(_cmd.GetDatabase(), &info) < 0) ||
+        !(_cmd.ForwardPrimerCount() > 0) || !(_cmd.ReversePrimerCount() > 0))
+    {
+        return(false);
+    }   // the index is optional, and needs a database and a pair of primers
+
+    if ((stat(_cmd.GetSeedIndex(), &st) < 0) || (st.st_size < static_cast<off_t>(sizeof(stSEEDHEADER))) ||
+        ((fd = open(_cmd.GetSeedIndex(), O_RDONLY)) < 0))
+    {
+        cout << "cannot open seed index: " << _cmd.GetSeedIndex() << endl;
+        return(false);
+    }   // make sure the index can be read
+
+    map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0); close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        cout << "cannot open seed index: " << _cmd.GetSeedIndex() << endl;
+        return(false);
+    }   // the mapping remains valid after the descriptor is closed
+
+    pMapped = static_cast<const unsigned char*>(map); nMapped = st.st_size;
+    memcpy(&header, pMapped, sizeof(stSEEDHEADER));
+
+    if (memcmp(header.magic, szSeedMAGIC, sizeof(szSeedMAGIC)) ||
+        !(header.size == static_cast<uint64_t>(info.st_size)) ||
+        !(header.inode == static_cast<uint64_t>(info.st_ino)) ||
+        !(header.mtime == static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec) ||
+        (header.block_offset % sizeof(uint64_t)) || (header.start_offset % sizeof(uint32_t)) ||
+        (header.block_offset > nMapped) || (header.start_offset > nMapped) || (header.flag_offset > nMapped) ||
+        ((nMapped - header.block_offset) / sizeof(stSEEDBLOCK) < header.blocks) ||
+        ((nMapped - header.start_offset) / sizeof(uint32_t) < header.records) ||
+        (nMapped - header.flag_offset < header.records))
+    {
+        cout << "seed index does not belong to the database: " << _cmd.GetSeedIndex() << endl;
+        Close(); return(false);
+    }   // the index must have been built from this very copy of the database
+
+    pBlock = reinterpret_cast<const stSEEDBLOCK*>(pMapped + header.block_offset);
+    pStart = reinterpret_cast<const uint32_t*>(pMapped + header.start_offset);
+    pFlag = pMapped + header.flag_offset;
+    nRecords = header.records; nBlocks = header.blocks;
+
+    for (size_t b = 0; b < nBlocks; ++b)
+    {
+        const stSEEDBLOCK& block = pBlock[b];
+
+        if ((block.offset % sizeof(uint32_t)) || (block.first + block.records > nRecords) ||
+            (block.offset > header.block_offset) ||
+            ((header.block_offset - block.offset) / sizeof(uint32_t) < nMaxSEED_TABLE + 1 + block.postings))
+        {
+            cout << "corrupted seed index: " << _cmd.GetSeedIndex() << endl;
+            Close(); return(false);
+        }   // the postings of every block must end before the block table
+    }
+
+    // the primers of the analysis, with the same settings as the analysis classes
+    unsigned int seed[nMaxSEED_EXPAND];
+
+    bvForwardPrimer.SetMismatch(_cmd.Mismatch(), _cmd.MaxBase());
+    bvReversePrimer.SetMismatch(_cmd.Mismatch(), _cmd.MaxBase());
+    bvForwardPrimer.SetForwardPrimer(_cmd.GetForwardPrimer(0));
+    bvReversePrimer.SetReversePrimer(_cmd.GetReversePrimer(0));
+
+    if ((BitPanel::Seed(bvForwardPrimer, true, seed) < 0) || (BitPanel::Seed(bvReversePrimer, false, seed) < 0))
+    {
+        cout << "primers are too short or too ambiguous for the seed index" << endl;
+        Close(); return(false);
+    }   // both primers must give a seed
+
+    Gather(bvForwardPrimer, true, vForward);
+    Gather(bvReversePrimer, false, vReverse);
+
+#ifdef _VERBOSE
+    cout << "seed index: " << nRecords << " records, " << nBlocks << " blocks, ";
+    cout << vForward.size() << " forward and " << vReverse.size() << " reverse windows" << endl;
+#endif  // _VERBOSE
+
+    return(true);
+#endif  // _WIN32
+}   // end of Open()
+
+/*
+ * release the mapping
+*/
+void SeedIndex::Close()
+{
+#ifndef _WIN32
+    if (pMapped)
+    {
+        munmap(const_cast<unsigned char*>(pMapped), nMapped);
+    }   // the index is mapped for this job alone
+#endif  // _WIN32
+
+    pMapped = 0; nMapped = 0; pBlock = 0; pStart = 0; pFlag = 0;
+    nRecords = 0; nBlocks = 0; vForward.clear(); vReverse.clear();
+}   // end of Close()
+
+/*
+ * collect the windows where the primer may match; the postings of every seed of the
+ * primer are turned into the record and the start of the window that the primer would
+ * take, in the same way as BitPanel::Probe(). the windows are sorted by record
+*/
+void SeedIndex::Gather(
+    const BitVector&    _primer,    // forward or reverse primer
+    bool                _forward,   // direction of the primer
+    vector<stWINDOW>&   _window)   // windows of the primer
+    const
+{
+    unsigned int seed[nMaxSEED_EXPAND];
+    int count = BitPanel::Seed(_primer, _forward, seed);
+    int shift = (_forward) ? nMaxSEED - _primer.GetLength() : 0;
+
+    for (size_t b = 0; b < nBlocks; ++b)
+    {
+        const stSEEDBLOCK& block = pBlock[b];
+        const uint32_t* bucket = reinterpret_cast<const uint32_t*>(pMapped + block.offset);
+        const uint32_t* posting = bucket + nMaxSEED_TABLE + 1;
+        const uint32_t *start = pStart + block.first, *last = start + block.records;
+
+        for (int k = 0; k < count; ++k)
+        {
+            for (uint32_t e = bucket[seed[k]]; e < bucket[seed[k] + 1]; ++e)
+            {
+                const uint32_t* r = upper_bound(start, last, posting[e]) - 1;
+                int w = static_cast<int>(posting[e] - (*r)) + shift;
+
+                if (!(w < 0))
+                {
+                    _window.push_back(make_pair(block.first + (r - start), w));
+                }   // the primer must start within the sequence
+            }   // every window of the block that may stand for the seed
+        }   // every seed of the primer
+    }   // the blocks of the index, one after another
+
+    sort(_window.begin(), _window.end());
+    _window.erase(unique(_window.begin(), _window.end()), _window.end());
+}   // end of Gather()
+
+/*
+ * test the primer at the windows of the record that share one of its seeds; returns the
+ * first window where the forward primer matches, or the last window where the reverse
+ * primer matches, as BitVector::FindPrimer() does over the whole sequence; -1 if none
+*/
+int SeedIndex::Search(
+    const BitLane&      _lane,      // expanded sequence
+    size_t              _record,    // number of the record in the database
+    const BitVector&    _primer,    // forward or reverse primer
+    bool                _forward)  // direction of the primer
+    const
+{
+    const vector<stWINDOW>& window = (_forward) ? vForward : vReverse;
+    vector<stWINDOW>::const_iterator first = lower_bound(window.begin(), window.end(), make_pair(_record, INT_MIN));
+    vector<stWINDOW>::const_iterator last = lower_bound(first, window.end(), make_pair(_record + 1, INT_MIN));
+    int end = _lane.GetLength() - _primer.GetLength();
+
+    for (int k = 0; k < last - first; ++k)
+    {
+        int w = (_forward) ? first[k].second : last[-k - 1].second;
+
+        if (!(w > end) && !(_primer.FindPrimer(_lane, w, w, _forward) < 0))
+        {
+            return(w);
+        }   // test the whole primer at this window only
+    }   // from the beginning for the forward primer, and from the end for the reverse
+
+    return(-1);
+}   // end of Search()
+
+/*
+ * delimit the sequence of a record with the primers, with the same outcome as
+ * BitLane::Delimit(). returns false if the record is not in the index; the sequence
+ * must then be searched as before
+*/
+bool SeedIndex::Delimit(
+    const BitLane&  _lane,      // expanded sequence
+    size_t          _record,    // number of the record in the database
+    stDELIMIT&      _d)        // positions of the primers
+    const
+{
+    if (!(_record < nRecords) || pFlag[_record])
+    {
+        return(false);
+    }   // the record is not in the index, or too ambiguous to be indexed
+
+    BitLane::Pair(_lane.GetLength(), bvForwardPrimer.GetLength(), bvReversePrimer.GetLength(),
+        Search(_lane, _record, bvForwardPrimer, true), Search(_lane, _record, bvReversePrimer, false), _d);
+    return(true);
+}   // end of Delimit()
@@ -0,0 +1,117 @@
+/*
+ * SEEDINDEX.H
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * this is the header file for the index of the primer seeds of a database
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#ifndef _SEEDINDEX_H
+#define _SEEDINDEX_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "cmdparam.h"
+#include "bitvector.h"
+
+using namespace std;
+
+const char szSeedMAGIC[8] = { 'M', 'I', 'C', 'A', 'S', 'E', 'D', '1' };
+
+const int nMaxSEED_TABLE    = 1 << (2 * nMaxSEED);  // number of distinct seeds
+const int nSeedBLOCK        = 1 << 25;  // bases of the records indexed together
+
+/*
+ * layout of the seed index written by mkindex; all numbers are stored in the byte order
+ * of the host. the records are indexed in blocks of about nSeedBLOCK bases, and the
+ * bases of a block are numbered one record after another. every block holds the first
+ * posting of each seed, and one more for the end, followed by the postings themselves,
+ * sorted by seed and then by base; a posting is the base of the block where a window of
+ * nMaxSEED bases may stand for the seed. an ambiguous window is posted under every seed
+ * it may stand for; a record with a window too ambiguous for that is marked in the flag
+ * table and searched as before. the block table, the first base of every record within
+ * its block, and the flags follow the postings
+*/
+typedef struct
+{
+    char magic[8];              // szSeedMAGIC
+    uint64_t size;              // size of the database in bytes
+    uint64_t inode;             // inode of the database
+    int64_t mtime;              // modification time of the database in nanoseconds
+    uint64_t records;           // number of records in the database
+    uint64_t blocks;            // number of blocks
+    uint64_t block_offset;      // block table; one stSEEDBLOCK for each block
+    uint64_t start_offset;      // first base of every record within its block
+    uint64_t flag_offset;       // one byte for every record; 1 if it is not indexed
+} stSEEDHEADER;
+
+typedef struct
+{
+    uint64_t first;             // first record of the block
+    uint64_t records;           // number of records in the block
+    uint64_t postings;          // number of postings in the block
+    uint64_t offset;            // first posting of each seed, then the postings
+} stSEEDBLOCK;
+
+/*
+ * class implementation of the primer seed index. the windows of nMaxSEED bases of every
+ * record are indexed once for the whole database by mkindex; the conserved region of
+ * the primers is expanded into seeds, as in BitPanel, and the primers are then only
+ * tested at the windows of a record that share one of their seeds, instead of searching
+ * the whole sequence. the index is named by seed_index in the parameter file and is only
+ * used if it has been built from the same database and both primers give a seed;
+ * otherwise the sequences are searched as before
+*/
+class   SeedIndex
+{
+public:
+    SeedIndex() : pMapped(0), nMapped(0), pBlock(0), pStart(0), pFlag(0), nRecords(0), nBlocks(0) {};
+    ~SeedIndex() { Close(); }
+
+    bool Open(CmdParam&);       // map the index and find the windows of the primers
+    void Close();               // release the mapping
+    bool IsOpen() const         { return(pMapped != 0); }
+
+    bool Delimit(const BitLane&, size_t, stDELIMIT&) const;
+
+private:
+    typedef pair<size_t, int> stWINDOW;     // record and the start of a window
+
+    void Gather(const BitVector&, bool, vector<stWINDOW>&) const;
+    int Search(const BitLane&, size_t, const BitVector&, bool) const;
+
+    const unsigned char* pMapped;   // the whole index
+    size_t nMapped;             // size of the mapping
+    const stSEEDBLOCK* pBlock;  // block table
+    const uint32_t* pStart;     // first base of every record within its block
+    const unsigned char* pFlag; // records that are not indexed
+    size_t nRecords;            // number of records in the index
+    size_t nBlocks;             // number of blocks in the index
+    BitVector bvForwardPrimer, bvReversePrimer;
+    vector<stWINDOW> vForward;  // windows where the forward primer may match
+    vector<stWINDOW> vReverse;  // windows where the reverse primer may match
+};  // end of class definition for SeedIndex
+
+#endif  // _SEEDINDEX_H
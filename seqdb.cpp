@@ -24,20 +24,78 @@
  * All rights reserved. Copyright (R) 2005.
  * last updated on April 15, 2005
  * revised on December 24, 2009
+ * added the memory-mapped reader on October 18, 2026
+ * replaced the line-limited stream reader with a block reader on October 18, 2026
+ * added the packed binary database format on October 18, 2026
+ * added the optional bit lanes of the sequences on October 18, 2026
+ * added the databases that stay mapped for the whole process on October 18, 2026
 */
 #include <seqdb.h>
 
+#include <cerrno>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif  // _WIN32
+
 // for debugging purpose
 //#define _VERBOSE
 
-const int   nDataBUFFER = 16384;
-const char* szDataDELIMIT = "|\n";
+const int   nDataBUFFER = 1048576;     // initial size of the block buffer
+const int   nDataFIELD = 4;
+const char  cDataDELIMIT = '|';          // lines are split at the newline already
+
+#ifndef _WIN32
+#ifdef MAP_POPULATE
+const int   nPreloadMAP = MAP_PRIVATE | MAP_POPULATE;  // read the file in while mapping
+#else
+const int   nPreloadMAP = MAP_PRIVATE;
+#endif  // MAP_POPULATE
+
+/*
+ * a database that stays mapped for the whole process; see Preload(). the file is known
+ * by its device and inode, so that any path to it finds the mapping, and the size and
+ * the modification time tell whether the file has been replaced since
+*/
+typedef struct
+{
+    dev_t device; ino_t inode;
+    off_t size; time_t modified;
+    const char* mapped;
+} stPRELOAD;
+
+static list<stPRELOAD> lsPreload;
+
+/*
+ * find the preloaded mapping of a file; returns 0 if the file has not been preloaded
+*/
+static const stPRELOAD* FindPreload(
+    const struct stat& _st)     // status of the database file
+{
+    for (list<stPRELOAD>::const_iterator i = lsPreload.begin(); !(i == lsPreload.end()); ++i)
+    {
+        if (((*i).device == _st.st_dev) && ((*i).inode == _st.st_ino) &&
+            ((*i).size == _st.st_size) && ((*i).modified == _st.st_mtime))
+        {
+            return(&(*i));
+        }   // same file, and it has not changed
+    }   // look through every preloaded database
+
+    return(0);
+}   // end of FindPreload()
+#endif  // _WIN32
 
 /*
  * class constructor; open the sequence file
 */
 SeqDB::SeqDB(
-    const char* _szFile)
+    const char* _szFile) : pMapped(0), nMapped(0), nCursor(0), bShared(false), nFile(-1),
+    pTable(0), bLanes(false)
 {
     if (!OpenFile(_szFile))
     {
@@ -48,49 +106,449 @@ SeqDB::SeqDB(
 bool SeqDB::OpenFile(
     const char* _szFile)
 {
-    ifInFile.open(_szFile, ios::in);
+    const char* _line; size_t _length;
+    CloseFile(); nFile = open(_szFile, O_RDONLY);
 
 #ifdef _VERBOSE
     cout << "sequence filename: " << _szFile << endl;
 #endif  // _VERBOSE
 
-    if (!ifInFile)
+    if (nFile < 0)
     {
         cout << "cannot open sequence file: " << _szFile << endl;
         return(false);
     }   // make sure the database file can be opened
 
-    return(true);
+    vcBuffer.resize(nDataBUFFER); nBegin = nEnd = nScan = 0;
+    bEndOfFile = false;
+
+    if (NextLine(_line, _length) && !(_length < sizeof(szBinaryMAGIC)) &&
+        !memcmp(_line, szBinaryMAGIC, sizeof(szBinaryMAGIC)))
+    {
+        cout << "binary database must be memory-mapped: " << _szFile << endl;
+        CloseFile(); return(false);
+    }   // the packed format cannot be read as a stream
+
+    nBegin = nScan = 0; return(true);
 }   // end of OpenFile()
 
 /*
- * look for the next record
+ * map the entire database into memory; the records are then handed out as views that
+ * point straight into the mapping, so that no sequence is copied on the read path.
+ * returns false if the file cannot be mapped; the caller may use OpenFile() instead
 */
-bool SeqDB::NextRecord()
+bool SeqDB::MapFile(
+    const char* _szFile)
 {
-    char buffer[nDataBUFFER];
+    CloseFile();
+
+#ifdef _WIN32
+    return(false);      // memory mapping is only supported on posix systems
+#else
+    struct stat st; const stPRELOAD* preload; void* map; int fd;
+
+#ifdef _VERBOSE
+    cout << "sequence filename: " << _szFile << " (mapped)" << endl;
+#endif  // _VERBOSE
 
-    if (!ifInFile.getline(buffer, nDataBUFFER))
+    if ((stat(_szFile, &st) < 0) || !S_ISREG(st.st_mode) || !(st.st_size > 0))
     {
         return(false);
-    }   // there is no more elements in the cache buffer
+    }   // only regular, non-empty files can be mapped; pipes must be streamed
+
+    if ((preload = FindPreload(st)))
+    {
+        pMapped = (*preload).mapped; bShared = true;
+    }   // the database is already in memory; share the mapping
+    else
+    {
+        if ((fd = open(_szFile, O_RDONLY)) < 0)
+        {
+            return(false);
+        }   // make sure the database file can be opened
+
+        map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0); close(fd);
 
-    // now parse the contents; note: the order is critical
-    szOrganism  = strtok(buffer, szDataDELIMIT);
-    szAccession = strtok(0, szDataDELIMIT);
-    szLocus     = strtok(0, szDataDELIMIT);
-    szOrigin    = strtok(0, szDataDELIMIT);
+        if (map == MAP_FAILED)
+        {
+            return(false);
+        }   // the mapping remains valid after the descriptor is closed
+
+        madvise(map, st.st_size, MADV_SEQUENTIAL);  // the database is read front to back
+        pMapped = static_cast<const char*>(map);
+    }   // map the database for this reader alone
+
+    nMapped = static_cast<size_t>(st.st_size); nCursor = 0;
+
+    if (!(nMapped < sizeof(szBinaryMAGIC)) &&
+        !memcmp(pMapped, szBinaryMAGIC, sizeof(szBinaryMAGIC)) && !SetBinary())
+    {
+        cout << "corrupted binary database: " << _szFile << endl;
+        CloseFile(); return(false);
+    }   // locate the sections of the packed binary database
+
+    return(true);
+#endif  // _WIN32
+}   // end of MapFile()
+
+/*
+ * map a database for the rest of the process and read it into memory; MapFile() then
+ * hands the same mapping to every reader of the file instead of mapping it again, and
+ * child processes inherit it. meant for a server that runs many analyses; see mica.cpp
+*/
+bool SeqDB::Preload(
+    const char* _szFile)
+{
+#ifdef _WIN32
+    return(false);      // memory mapping is only supported on posix systems
+#else
+    struct stat st; stPRELOAD item; void* map; int fd;
+
+    if ((stat(_szFile, &st) < 0) || !S_ISREG(st.st_mode) || !(st.st_size > 0))
+    {
+        return(false);
+    }   // only regular, non-empty files can be mapped
+
+    if (FindPreload(st))
+    {
+        return(true);
+    }   // the database is already in memory
+
+    if ((fd = open(_szFile, O_RDONLY)) < 0)
+    {
+        return(false);
+    }   // make sure the database file can be opened
+
+    map = mmap(0, st.st_size, PROT_READ, nPreloadMAP, fd, 0); close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        return(false);
+    }   // the mapping remains valid after the descriptor is closed
+
+    madvise(map, st.st_size, MADV_WILLNEED);    // the whole database will be read
+
+    item.device = st.st_dev, item.inode = st.st_ino;
+    item.size = st.st_size, item.modified = st.st_mtime;
+    item.mapped = static_cast<const char*>(map);
+    lsPreload.push_back(item); return(true);
+#endif  // _WIN32
+}   // end of Preload()
+
+/*
+ * close the database and release the mapping
+*/
+void SeqDB::CloseFile()
+{
+#ifndef _WIN32
+    if (pMapped && !bShared)
+    {
+        munmap(const_cast<char*>(pMapped), nMapped);
+    }   // release the memory-mapped database; preloaded ones stay mapped
+#endif  // _WIN32
+
+    pMapped = 0; nMapped = nCursor = 0; pTable = 0; bShared = false;
+
+    if (!(nFile < 0))
+    {
+        close(nFile); nFile = -1;
+    }   // close the streamed database
+}   // end of CloseFile()
+
+/*
+ * look for the next record
+*/
+bool SeqDB::NextRecord()
+{
+    if (!NextRecord(stCurrent))
+    {
+        return(false);
+    }   // there is no more records in the database
 
 #ifdef _VERBOSE
-    cout << " szOrganism: " << szOrganism << endl;
-    cout << "szAccession: " << szAccession << endl;
-    cout << "    szLocus: " << szLocus << endl;
-    cout << "   szOrigin: " << szOrigin << endl;
+    cout << " szOrganism: " << stCurrent.organism << endl;
+    cout << "szAccession: " << stCurrent.accession << endl;
+    cout << "    szLocus: " << stCurrent.locus << endl;
+    cout << "   szOrigin: " << stCurrent.origin << endl;
 #endif  // _VERBOSE
 
     return(true);
 }   // end of NextRecord()
 
+/*
+ * retrieve the next record into the structure provided by the caller; when requested
+ * with SetLanes(), the sequence is also expanded into its bit lanes, so that the tools
+ * can search the primers and enzymes a word at a time
+*/
+bool SeqDB::NextRecord(
+    stSEQUENCE& _rec)
+{
+    if (!Fetch(_rec))
+    {
+        return(false);
+    }   // there is no more records in the database
+
+    if (bLanes)
+    {
+        _rec.lanes.Encode(_rec.origin);
+    }   // expand the sequence once for all the searches
+
+    return(true);
+}   // end of NextRecord()
+
+/*
+ * locate the next record; a mapped record points into the database, a streamed record
+ * is first copied into its own cache. blank and malformed lines without a sequence are
+ * skipped
+*/
+bool SeqDB::Fetch(
+    stSEQUENCE& _rec)
+{
+    const char* line; const char* next; size_t length;
+
+    while (pTable && (nRecord < nRecords))
+    {
+        if (Unpack(pTable[nRecord++], _rec))
+        {
+            return(true);
+        }   // the sequence is decoded into the cache of the record
+    }   // the binary database holds one table entry per record
+
+    if (pTable)
+    {
+        return(false);
+    }   // the mapping of a binary database is not made of lines
+
+    while (pMapped && (nCursor < nMapped))
+    {
+        line = pMapped + nCursor;
+        next = static_cast<const char*>(memchr(line, '\n', nMapped - nCursor));
+        length = (next) ? static_cast<size_t>(next - line) : nMapped - nCursor;
+        nCursor += length + 1;
+
+        if (Parse(line, length, _rec))
+        {
+            return(true);
+        }   // hand out the views into the mapping
+    }   // walk through the mapping line by line
+
+    while (!(nFile < 0) && NextLine(line, length))
+    {
+        _rec.cache.assign(line, length);
+
+        if (Parse(_rec.cache.data(), _rec.cache.length(), _rec))
+        {
+            return(true);
+        }   // the views point into the cache of the record
+    }   // read the database line by line
+
+    return(false);      // there is no more records in the database
+}   // end of Fetch()
+
+/*
+ * retrieve the next line from the streamed database; the database is read in large
+ * blocks with read(2), and the buffer grows whenever a line does not fit, so there
+ * is no limit on the length of a record. the line stays valid until the next call
+*/
+bool SeqDB::NextLine(
+    const char*&    _line,      // start of the line in the block buffer
+    size_t&         _length)   // length of the line, without the newline
+{
+    const char* next; ssize_t bytes;
+
+    for (;;)
+    {
+        next = static_cast<const char*>(
+            memchr(vcBuffer.data() + nScan, '\n', nEnd - nScan));
+
+        if (next || (bEndOfFile && (nBegin < nEnd)))
+        {
+            _line = vcBuffer.data() + nBegin;
+            _length = (next) ? static_cast<size_t>(next - _line) : nEnd - nBegin;
+            nBegin += _length + ((next) ? 1 : 0); nScan = nBegin;
+            return(true);
+        }   // a complete line, or the last line without a newline
+
+        if (bEndOfFile)
+        {
+            return(false);
+        }   // there is nothing left in the database
+
+        if (nBegin > 0)
+        {
+            memmove(vcBuffer.data(), vcBuffer.data() + nBegin, nEnd - nBegin);
+            nEnd -= nBegin; nBegin = 0;
+        }   // move the partial line to the front of the buffer
+
+        if (nEnd == vcBuffer.size())
+        {
+            vcBuffer.resize(vcBuffer.size() * 2);
+        }   // the line is longer than the buffer; make room for it
+
+        nScan = nEnd;   // the partial line has been searched already
+        bytes = read(nFile, vcBuffer.data() + nEnd, vcBuffer.size() - nEnd);
+
+        if ((bytes < 0) && (errno == EINTR))
+        {
+            continue;
+        }   // interrupted before anything was read; try again
+
+        bEndOfFile = !(bytes > 0);
+        nEnd += (bytes > 0) ? static_cast<size_t>(bytes) : 0;
+    }   // refill the buffer until a complete line is available
+}   // end of NextLine()
+
+/*
+ * split a line into the organism, accession, locus, and sequence fields; the fields
+ * are delimited the same way as strtok() would do, but without copying any character.
+ * note: the order is critical
+*/
+bool SeqDB::Parse(
+    const char* _line,      // start of the line
+    size_t      _length,    // length of the line, without the newline
+    stSEQUENCE& _rec)      // record that receives the views
+{
+    const char* last = _line + _length; const char* next;
+    string_view field[nDataFIELD];
+
+    for (int i = 0; i < nDataFIELD; ++i)
+    {
+        while ((_line < last) && (*_line == cDataDELIMIT))
+        {
+            ++_line;
+        }   // skip the empty fields, just as strtok() does
+
+        if (!(_line < last))
+        {
+            break;
+        }   // there are less fields than expected
+
+        next = static_cast<const char*>(memchr(_line, cDataDELIMIT, last - _line));
+        next = (next) ? next : last;
+        field[i] = string_view(_line, next - _line); _line = next;
+    }   // locate the fields one after another
+
+    _rec.organism  = field[0];
+    _rec.accession = field[1];
+    _rec.locus     = field[2];
+    _rec.origin    = field[3];
+
+    return(!_rec.origin.empty());
+}   // end of Parse()
+
+/*
+ * validate the header of the binary database and locate its sections in the mapping;
+ * every offset is checked once here, so that the records can be unpacked without
+ * any further bound checks
+*/
+bool SeqDB::SetBinary()
+{
+    stBINHEADER header; size_t packed, runs;
+
+    if (nMapped < sizeof(stBINHEADER))
+    {
+        return(false);
+    }   // the header is incomplete
+
+    memcpy(&header, pMapped, sizeof(stBINHEADER));
+
+    if ((header.exception_offset > header.heap_offset) ||
+        (header.heap_offset > header.table_offset) ||
+        (header.table_offset > nMapped) ||
+        (header.exception_offset % alignof(stBINEXCEPTION)) ||
+        (header.table_offset % alignof(stBINENTRY)) ||
+        ((nMapped - header.table_offset) / sizeof(stBINENTRY) < header.records))
+    {
+        return(false);
+    }   // the sections must be in order and within the file
+
+    pTable = reinterpret_cast<const stBINENTRY*>(pMapped + header.table_offset);
+    pException = reinterpret_cast<const stBINEXCEPTION*>(pMapped + header.exception_offset);
+    pHeap = pMapped + header.heap_offset;
+    nRecords = header.records; nRecord = 0;
+    runs = (header.heap_offset - header.exception_offset) / sizeof(stBINEXCEPTION);
+
+    for (size_t i = 0; i < nRecords; ++i)
+    {
+        const stBINENTRY& entry = pTable[i];
+        packed = (static_cast<size_t>(entry.origin) + 3) / 4;
+
+        if ((entry.packed < sizeof(stBINHEADER)) ||
+            (entry.packed + packed > header.exception_offset) ||
+            (entry.heap + entry.organism + entry.accession + entry.locus >
+                header.table_offset - header.heap_offset) ||
+            (entry.exception + entry.exceptions > runs))
+        {
+            pTable = 0; return(false);
+        }   // every record must stay within its sections
+
+        for (uint32_t j = 0; j < entry.exceptions; ++j)
+        {
+            const stBINEXCEPTION& run = pException[entry.exception + j];
+
+            if (static_cast<size_t>(run.position) + run.length > entry.origin)
+            {
+                pTable = 0; return(false);
+            }   // the run must lie within the sequence
+        }   // check the exception runs of the record
+    }   // check the offset table
+
+    return(true);
+}   // end of SetBinary()
+
+/*
+ * rebuild a record of the binary database; the descriptive fields are views into the
+ * heap, while the sequence is decoded four bases at a time into the cache of the record
+ * and the bases that could not be packed are restored from the exception runs
+*/
+bool SeqDB::Unpack(
+    const stBINENTRY&   _entry,     // table entry of the record
+    stSEQUENCE&         _rec)      // record that receives the views
+{
+    struct stUNPACK
+    {
+        char base[256][4];
+
+        stUNPACK()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                for (int j = 0; j < 4; ++j)
+                {
+                    base[i][j] = "ACGT"[(i >> (6 - 2 * j)) & 3];
+                }   // the first base is in the highest bits
+            }   // decode all possible bytes once
+        }   // constructor
+    };  // lookup table shared by all records; built once on first use
+
+    static const stUNPACK table;
+    const unsigned char* packed = reinterpret_cast<const unsigned char*>(pMapped + _entry.packed);
+    const char* heap = pHeap + _entry.heap;
+    size_t length = _entry.origin; char* base;
+
+    _rec.cache.resize((length + 3) & ~static_cast<size_t>(3)); base = &_rec.cache[0];
+
+    for (size_t i = 0; i < length; i += 4)
+    {
+        memcpy(base + i, table.base[*packed++], 4);
+    }   // decode four bases per byte
+
+    _rec.cache.resize(length);
+
+    for (uint32_t i = 0; i < _entry.exceptions; ++i)
+    {
+        const stBINEXCEPTION& run = pException[_entry.exception + i];
+        memset(base + run.position, run.base, run.length);
+    }   // restore the bases that are not A, C, G, or T
+
+    _rec.organism  = string_view(heap, _entry.organism); heap += _entry.organism;
+    _rec.accession = string_view(heap, _entry.accession); heap += _entry.accession;
+    _rec.locus     = string_view(heap, _entry.locus);
+    _rec.origin    = string_view(_rec.cache.data(), length);
+
+    return(!_rec.origin.empty());
+}   // end of Unpack()
+
 /*
  * print out the entire list of locus names in the database
 */
@@ -98,7 +556,7 @@ void SeqDB::PrintLocus()
 {
     while(NextRecord())
     {
-        cout << szLocus << endl;
+        cout << stCurrent.locus << endl;
     }   // print out sequence locus information
 }   // end of PrintLocus()
 
@@ -110,7 +568,7 @@ void SeqDB::PrintOrigin()
 {
     while(NextRecord())
     {
-        cout << szOrigin << endl;
+        cout << stCurrent.origin << endl;
     }   // print out the sequence
 }   // end of PrintOrigin()
 
@@ -121,7 +579,7 @@ void SeqDB::PrintOrganism()
 {
     while(NextRecord())
     {
-        cout << szOrganism << endl;
+        cout << stCurrent.organism << endl;
     }   // print out the name of organism
 }   // end of PrintOrganism()
 
@@ -132,7 +590,7 @@ void SeqDB::PrintAccession()
 {
     while(NextRecord())
     {
-        cout << szAccession << endl;
+        cout << stCurrent.accession << endl;
     }   // print out access number
 }   // end of PrintAccession()
 
@@ -140,19 +598,28 @@ void SeqDB::PrintAccession()
  * test driver program
 */
 /*
+#include <sys/time.h>
+
 int main(int argc, char** argv)
 {
-    SeqDB rdp; rdp.OpenFile("bacteria_all.txt");
+    SeqDB rdp; rdp.OpenFile("bacteria_all.txt");  // or rdp.MapFile()
 
     double mean = 0.0;
     double count = 0.0;
+    double bytes = 0.0;
+    struct timeval start, stop; gettimeofday(&start, 0);
 
     while (rdp.NextRecord())
     {
         count += 1.0;
         mean += (static_cast<double>((rdp.GetOrigin()).size()) - mean) / count;
+        bytes += (rdp.GetOrganism()).size() + (rdp.GetAccession()).size() +
+            (rdp.GetLocus()).size() + (rdp.GetOrigin()).size() + 4;
     }   // calculate the running average
 
+    gettimeofday(&stop, 0);
+    double elapsed = (stop.tv_sec - start.tv_sec) + (stop.tv_usec - start.tv_usec) / 1e6;
     printf("total: %.0f, average: %.4f\n", count, mean);
+    printf("throughput: %.1f MB/s\n", bytes / elapsed / 1048576.0);
 }   // end of main()
 */
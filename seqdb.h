@@ -29,45 +29,140 @@
  * All rights reserved. Copyright (R) 2004.
  * last updated on June 26, 2004
  * revised on December 24, 2009
+ * added the memory-mapped reader on October 18, 2026
+ * replaced the line-limited stream reader with a block reader on October 18, 2026
+ * added the packed binary database format on October 18, 2026
+ * added the optional bit lanes of the sequences on October 18, 2026
+ * added the databases that stay mapped for the whole process on October 18, 2026
 */
 #ifndef _SEQDB_H
 #define _SEQDB_H
 
 #include <list>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <cstdlib>
 #include <cstring>
+#include <cstdint>
 #include <iostream>
+#include <string_view>
+
+#include "bitvector.h"
 
 using namespace std;
 
+/*
+ * layout of the packed binary database written by txt2bin; all numbers are stored in
+ * the byte order of the host. the file starts with the header, followed by the packed
+ * sequences (2 bits per base, 4 bases per byte, first base in the highest bits), the
+ * runs of bases that cannot be packed, the heap of descriptive fields, and the offset
+ * table with one entry per record. anything other than A, C, G, and T is stored in the
+ * exception runs, so that the conversion is lossless
+*/
+const char szBinaryMAGIC[8] = { 'M', 'i', 'C', 'A', 'b', 'i', 'n', '1' };
+
+typedef struct
+{
+    char magic[8];              // identifies the file as a packed binary database
+    uint64_t records;           // number of records in the database
+    uint64_t exception_offset;  // start of the exception runs
+    uint64_t heap_offset;       // start of the heap of descriptive fields
+    uint64_t table_offset;      // start of the offset table
+} stBINHEADER;
+
+typedef struct
+{
+    uint64_t heap;              // offset of the fields relative to the heap
+    uint64_t packed;            // offset of the packed sequence in the file
+    uint64_t exception;         // index of the first exception run of the record
+    uint32_t organism;          // length of the organism name
+    uint32_t accession;         // length of the accession number
+    uint32_t locus;             // length of the locus name
+    uint32_t origin;            // number of bases in the sequence
+    uint32_t exceptions;        // number of exception runs of the record
+    uint32_t reserved;
+} stBINENTRY;
+
+typedef struct
+{
+    uint32_t position;          // first base of the run
+    uint16_t length;            // number of bases in the run
+    char base;                  // the character that could not be packed
+    char reserved;
+} stBINEXCEPTION;
+
+/*
+ * a single record retrieved from the database; the fields are views that point either
+ * into the memory-mapped database or into the cache of the record itself. the views
+ * stay valid until the record is filled again, or as long as the database is mapped.
+ * note: do not copy a streamed record; the views would still point to the old cache
+*/
+typedef struct
+{
+    string_view organism;   // name of the organism
+    string_view accession;  // genbank accession number
+    string_view locus;      // locus name
+    string_view origin;     // nucleotide sequence
+    string cache;           // storage for the streamed line; not used when mapped
+    BitLane lanes;          // sequence expanded into bit streams; see SeqDB::SetLanes()
+} stSEQUENCE;
+
 /*
  * class implementation to parse the sequences from the plain text format
 */
 class   SeqDB
 {
 public:
-    SeqDB() {};     // default constructor
+    SeqDB() : pMapped(0), nMapped(0), nCursor(0), bShared(false), nFile(-1), pTable(0),
+        bLanes(false) {};
     SeqDB(const char*);
-    ~SeqDB() { ifInFile.close(); }
+    ~SeqDB() { CloseFile(); }
 
     // inline functions
-    const string& GetLocus() const      { return(szLocus); }
-    const string& GetOrigin() const     { return(szOrigin); }
-    const string& GetOrganism() const   { return(szOrganism); }
-    const string& GetAccession() const  { return(szAccession); }
+    string_view GetLocus() const        { return(stCurrent.locus); }
+    string_view GetOrigin() const       { return(stCurrent.origin); }
+    string_view GetOrganism() const     { return(stCurrent.organism); }
+    string_view GetAccession() const    { return(stCurrent.accession); }
+    bool IsMapped() const               { return(!(pMapped == 0)); }
+    bool IsBinary() const               { return(!(pTable == 0)); }
+    void SetLanes(bool _lanes)          { bLanes = _lanes; }
 
     bool OpenFile(const char*);
+    bool MapFile(const char*);  // map the database into memory; zero-copy records
+    static bool Preload(const char*);   // keep a database in memory for the whole process
     bool NextRecord();          // retrieve the next available sequence
+    bool NextRecord(stSEQUENCE&);
+    void CloseFile();
     void PrintLocus();
     void PrintOrigin();
     void PrintOrganism();
     void PrintAccession();
 
 private:
-    ifstream ifInFile;
-    string szAccession, szLocus, szOrigin, szOrganism;
+    stSEQUENCE stCurrent;       // record used by NextRecord() without arguments
+
+    const char* pMapped;        // start of the memory-mapped database
+    size_t nMapped, nCursor;    // size of the mapping and offset of the next record
+    bool bShared;               // the mapping belongs to a preloaded database
+
+    int nFile;                  // file descriptor of the streamed database
+    vector<char> vcBuffer;      // growable block buffer for the stream reader
+    size_t nBegin, nEnd, nScan; // unread data, and where the newline search resumes
+    bool bEndOfFile;
+
+    const stBINENTRY* pTable;           // offset table of the binary database
+    const stBINEXCEPTION* pException;   // exception runs of the binary database
+    const char* pHeap;                  // heap of the descriptive fields
+    size_t nRecords, nRecord;           // number of records and the next one to read
+
+    bool bLanes;                // expand every sequence into its bit lanes
+
+    bool Fetch(stSEQUENCE&);
+    bool Parse(const char*, size_t, stSEQUENCE&);
+    bool NextLine(const char*&, size_t&);
+    bool SetBinary();
+    bool Unpack(const stBINENTRY&, stSEQUENCE&);
 };
 
 #endif  // _SEQDB_H
@@ -0,0 +1,186 @@
+/*
+ * SEQQUEUE.CPP
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#include <seqqueue.h>
+
+// for debugging purpose
+//#define _VERBOSE
+
+const int nBatchRECORD = 1000;          // records in a batch
+const size_t nBatchBYTES = 1048576;     // or bases in a batch, whichever comes first
+
+/*
+ * class constructor; the reader is started with Start()
+*/
+SeqQueue::SeqQueue() :
+    pDatabase(0), bLanes(false), bDone(true), bStop(false), bRunning(false)
+{
+    pthread_mutex_init(&mtxLock, NULL);
+    pthread_cond_init(&cvFull, NULL);
+    pthread_cond_init(&cvFree, NULL);
+}   // end of class constructor
+
+/*
+ * start the reader thread; _depth is the number of batches, which bounds the amount of
+ * memory held by the queue. twice the number of workers keeps every worker busy while
+ * the reader fills the next batch
+*/
+bool SeqQueue::Start(
+    SeqDB&  _db,        // database to be read
+    int     _depth,     // number of batches in the queue
+    bool    _lanes)    // expand the sequences into bit lanes
+{
+    Stop(); pDatabase = &_db; bLanes = _lanes;
+    vBatch.assign((_depth > 0) ? _depth : 1, stBATCH());
+    lsFull.clear(); lsFree.clear();
+
+    for (unsigned int i = 0; i < vBatch.size(); ++i)
+    {
+        vBatch[i].records.resize(nBatchRECORD); vBatch[i].count = 0;
+        lsFree.push_back(&vBatch[i]);
+    }   // all batches are free at the beginning
+
+    bDone = bStop = false;
+
+    if (!(bRunning = !pthread_create(&ptReader, NULL, &SeqQueue::Read, this)))
+    {
+        bDone = true;
+    }   // the workers find an empty queue if the reader cannot be started
+
+    return(bRunning);
+}   // end of Start()
+
+/*
+ * stop the reader thread, even if the database has not been exhausted
+*/
+void SeqQueue::Stop()
+{
+    if (!bRunning)
+    {
+        return;
+    }   // the reader has not been started
+
+    pthread_mutex_lock(&mtxLock);
+    bStop = true; pthread_cond_broadcast(&cvFree);
+    pthread_mutex_unlock(&mtxLock);
+
+    pthread_join(ptReader, NULL); bRunning = false;
+}   // end of Stop()
+
+/*
+ * take the next batch; the bit lanes are expanded here, by the worker, so that the
+ * reader thread only has to parse the database
+*/
+stBATCH* SeqQueue::Pop()
+{
+    stBATCH* batch = 0;
+
+    pthread_mutex_lock(&mtxLock);
+
+    while (lsFull.empty() && !bDone)
+    {
+        pthread_cond_wait(&cvFull, &mtxLock);
+    }   // wait for the reader
+
+    if (!lsFull.empty())
+    {
+        batch = lsFull.front(); lsFull.pop_front();
+    }   // otherwise, the database is exhausted
+
+    pthread_mutex_unlock(&mtxLock);
+
+    for (int i = 0; batch && bLanes && (i < batch->count); ++i)
+    {
+        batch->records[i].lanes.Encode(batch->records[i].origin);
+    }   // expand the sequences outside the lock
+
+    return(batch);
+}   // end of Pop()
+
+/*
+ * hand a used batch back to the reader
+*/
+void SeqQueue::Release(
+    stBATCH* _batch)
+{
+    pthread_mutex_lock(&mtxLock);
+    lsFree.push_back(_batch); pthread_cond_signal(&cvFree);
+    pthread_mutex_unlock(&mtxLock);
+}   // end of Release()
+
+/*
+ * main loop of the reader thread; fill the free batches until the database is exhausted
+*/
+void* SeqQueue::Read(
+    void* _queue)
+{
+    SeqQueue* queue = static_cast<SeqQueue*>(_queue);
+    stBATCH* batch; size_t bases, records = 0; bool more = true;
+
+    while (more)
+    {
+        pthread_mutex_lock(&queue->mtxLock);
+
+        while (queue->lsFree.empty() && !queue->bStop)
+        {
+            pthread_cond_wait(&queue->cvFree, &queue->mtxLock);
+        }   // wait until a worker releases a batch
+
+        if (queue->bStop)
+        {
+            pthread_mutex_unlock(&queue->mtxLock); break;
+        }   // the queue is shutting down
+
+        batch = queue->lsFree.front(); queue->lsFree.pop_front();
+        pthread_mutex_unlock(&queue->mtxLock);
+
+        for (batch->count = 0, bases = 0; (batch->count < nBatchRECORD) &&
+            (bases < nBatchBYTES); bases += batch->records[batch->count++].origin.length())
+        {
+            if (!(more = queue->pDatabase->NextRecord(batch->records[batch->count])))
+            {
+                break;
+            }   // there is no more records in the database
+        }   // fill the batch outside the lock
+
+        batch->first = records; records += batch->count;
+
+#ifdef _VERBOSE
+        cout << "batch: " << batch->count << " records, " << bases << " bases" << endl;
+#endif  // _VERBOSE
+
+        pthread_mutex_lock(&queue->mtxLock);
+        ((batch->count > 0) ? queue->lsFull : queue->lsFree).push_back(batch);
+        pthread_cond_signal(&queue->cvFull);
+        pthread_mutex_unlock(&queue->mtxLock);
+    }   // keep reading the database
+
+    pthread_mutex_lock(&queue->mtxLock);
+    queue->bDone = true; pthread_cond_broadcast(&queue->cvFull);
+    pthread_mutex_unlock(&queue->mtxLock);
+
+    return(NULL);
+}   // end of Read()
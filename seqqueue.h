@@ -0,0 +1,83 @@
+/*
+ * SEQQUEUE.H
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * this is the header file for the queue that hands the records to the worker threads
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#ifndef _SEQQUEUE_H
+#define _SEQQUEUE_H
+
+#include <list>
+#include <vector>
+#include <pthread.h>
+
+#include "seqdb.h"
+
+using namespace std;
+
+/*
+ * a batch of records; the records are reused from one batch to the next, so that the
+ * caches of the streamed records and the bit lanes keep their memory
+*/
+typedef struct
+{
+    vector<stSEQUENCE> records;     // storage for the records
+    int count;                      // number of records filled in
+    size_t first;                   // number of the first record in the database
+} stBATCH;
+
+/*
+ * class implementation of a bounded queue of record batches; a dedicated thread reads
+ * the database and fills the batches, while the worker threads take one batch at a
+ * time. the workers therefore synchronize once per batch instead of once per record,
+ * and the parsing overlaps with the analysis
+*/
+class   SeqQueue
+{
+public:
+    SeqQueue();
+    ~SeqQueue()     { Stop(); }
+
+    bool Start(SeqDB&, int, bool = false);  // start reading the database
+    stBATCH* Pop();             // next batch, or 0 when the database is exhausted
+    void Release(stBATCH*);     // return a batch once its records have been used
+    void Stop();                // stop reading and wait for the reader thread
+
+private:
+    SeqDB* pDatabase;
+    vector<stBATCH> vBatch;     // all the batches; their number bounds the queue
+    list<stBATCH*> lsFull, lsFree;
+    bool bLanes;                // expand the sequences into bit lanes in the workers
+    bool bDone, bStop, bRunning;
+
+    pthread_t ptReader;
+    pthread_mutex_t mtxLock;    // protects the lists and the flags
+    pthread_cond_t cvFull;      // signals the workers that a batch is ready
+    pthread_cond_t cvFree;      // signals the reader that a batch has been released
+
+    static void* Read(void*);   // main loop of the reader thread
+};  // end of class definition for SeqQueue
+
+#endif  // _SEQQUEUE_H
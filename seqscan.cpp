@@ -0,0 +1,99 @@
+/*
+ * SEQSCAN.CPP
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#include <seqscan.h>
+
+// what the threads of a scan share
+typedef struct
+{
+    SeqQueue* queue;                // batches of the database
+    const vector<stQUERY>* query;   // jobs taking part in the scan
+} stSCAN;
+
+/*
+ * the main loop of a scan thread; every batch goes to all the jobs before it is handed
+ * back, so that the records are still in the cache for the next job
+*/
+static void* ScanWorker(
+    void* _scan)
+{
+    const stSCAN& scan = *static_cast<stSCAN*>(_scan);
+    const vector<stQUERY>& query = *scan.query;
+    vector<void*> worker(query.size());
+    stBATCH* batch;
+
+    for (size_t j = 0; j < query.size(); ++j)
+    {
+        worker[j] = query[j].analysis->start(query[j].job);
+    }   // every job gets a worker of its own in this thread
+
+    while ((batch = scan.queue->Pop()))
+    {
+        for (size_t j = 0; j < query.size(); ++j)
+        {
+            query[j].analysis->scan(query[j].job, worker[j], batch);
+        }   // the batch is read once for all jobs
+
+        scan.queue->Release(batch);       // hand the batch back to the reader
+    }   // keep taking batches until the database is exhausted
+
+    for (size_t j = 0; j < query.size(); ++j)
+    {
+        query[j].analysis->stop(query[j].job, worker[j]);
+    }   // merge the results of this thread into the jobs
+
+    return(NULL);
+}   // end of ScanWorker()
+
+/*
+ * scan the database with _threads workers; 0 uses all available processors. the jobs
+ * must have been opened, and are closed by the caller once the scan has returned.
+ * returns false if the database cannot be read, in which case no record is scanned
+*/
+bool ScanDatabase(
+    const char*             _database,  // sequence database
+    int                     _threads,   // number of worker threads
+    const vector<stQUERY>&  _query)    // jobs taking part in the scan
+{
+    SeqDB rdp; SeqQueue dbq;
+
+    if (!rdp.MapFile(_database) && !rdp.OpenFile(_database))
+    {
+        return(false);
+    }   // map the sequence database; otherwise, read it as a stream
+
+    ThreadPool pool(_threads);          // one worker per processor unless specified
+    stSCAN scan = { &dbq, &_query };
+    dbq.Start(rdp, 2 * pool.GetThreads(), true);   // read the records in batches
+
+    for (int i = 0; i < pool.GetThreads(); ++i)
+    {
+        pool.Submit(&ScanWorker, &scan);
+    }   // every worker keeps taking batches until the database is exhausted
+
+    pool.Wait();                        // wait for all threads to complete
+    return(true);
+}   // end of ScanDatabase()
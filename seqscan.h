@@ -0,0 +1,76 @@
+/*
+ * SEQSCAN.H
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * this is the header file for the scan that feeds the records of a database to one or
+ * more analyses at the same time
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#ifndef _SEQSCAN_H
+#define _SEQSCAN_H
+
+#include <vector>
+#include <pthread.h>
+
+#include "seqdb.h"
+#include "cmdparam.h"
+#include "threadpool.h"
+#include "seqqueue.h"
+
+using namespace std;
+
+/*
+ * the hooks of an analysis program into the scan. a job holds everything one analysis
+ * needs, so that several jobs, of the same program or not, can share a single scan of
+ * the database. a worker is the state that one thread keeps for a job; it is merged into
+ * the job once the database is exhausted. the hooks are called in this order: open once,
+ * start in every thread, scan for every batch the thread takes, stop in every thread, and
+ * close once all threads are done
+*/
+typedef struct
+{
+    const char* name;                       // name of the program, as on the command line
+    void* (*open)(const char*);             // read the parameter file and set up a job; 0 if it fails
+    CmdParam& (*param)(void*);              // parameters of a job
+    void* (*start)(void*);                  // set up a worker for a job
+    void (*scan)(void*, void*, stBATCH*);   // analyze a batch of records
+    void (*stop)(void*, void*);             // merge a worker into its job
+    bool (*close)(void*);                   // write the outputs and release the job
+} stANALYSIS;
+
+// a job taking part in a scan
+typedef struct
+{
+    const stANALYSIS* analysis;     // program of the job
+    void* job;                      // as returned by open
+} stQUERY;
+
+/*
+ * read the database once and hand every batch to all the jobs in turn; the records are
+ * parsed and expanded into bit lanes once, however many jobs there are. returns false
+ * if the database cannot be read
+*/
+bool ScanDatabase(const char*, int, const vector<stQUERY>&);
+
+#endif  // _SEQSCAN_H
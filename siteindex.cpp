@@ -0,0 +1,218 @@
+/*
+ * SITEINDEX.CPP
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#include <siteindex.h>
+
+#include <cstring>
+#include <fcntl.h>
+#include <algorithm>
+#include <iostream>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif  // _WIN32
+
+// for debugging purpose
+//#define _VERBOSE
+
+/*
+ * map the site index named in the parameter file and find the enzymes of the analysis
+ * in its catalogue. returns false if there is no index, or it cannot be used; the
+ * amplicons are then scanned for the sites instead
+*/
+bool SiteIndex::Open(
+    CmdParam& _cmd)    // command-line parameters
+{
+    Close();
+
+#ifdef _WIN32
+    return(false);      // memory mapping is only supported on posix systems
+#else
+    struct stat info, st; stSITEHEADER header; void* map; int fd;
+
+    if (!(*_cmd.GetIndex()) || (stat(_cmd.GetDatabase(), &info) < 0))
+    {
+        return(false);
+    }   // the index is optional, and needs a database
+
+    if ((stat(_cmd.GetIndex(), &st) < 0) || (st.st_size < static_cast<off_t>(sizeof(stSITEHEADER))) ||
+        ((fd = open(_cmd.GetIndex(), O_RDONLY)) < 0))
+    {
+        cout << "cannot open site index: " << _cmd.GetIndex() << endl;
+        return(false);
+    }   // make sure the index can be read
+
+    map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0); close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        cout << "cannot open site index: " << _cmd.GetIndex() << endl;
+        return(false);
+    }   // the mapping remains valid after the descriptor is closed
+
+    pMapped = static_cast<const unsigned char*>(map); nMapped = st.st_size;
+    memcpy(&header, pMapped, sizeof(stSITEHEADER));
+
+    if (memcmp(header.magic, szSiteMAGIC, sizeof(szSiteMAGIC)) ||
+        !(header.size == static_cast<uint64_t>(info.st_size)) ||
+        !(header.inode == static_cast<uint64_t>(info.st_ino)) ||
+        !(header.mtime == static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec) ||
+        (header.table_offset % sizeof(uint64_t)) || (header.table_offset > nMapped) ||
+        ((nMapped - header.table_offset) / sizeof(uint64_t) < header.records + 1) ||
+        (header.enzyme_offset > nMapped))
+    {
+        cout << "site index does not belong to the database: " << _cmd.GetIndex() << endl;
+        Close(); return(false);
+    }   // the index must have been built from this very copy of the database
+
+    pTable = reinterpret_cast<const uint64_t*>(pMapped + header.table_offset);
+    nRecords = header.records; nEnzymes = header.enzymes;
+
+    if ((pTable[nRecords] & ~uWideSITES) > header.table_offset)
+    {
+        cout << "corrupted site index: " << _cmd.GetIndex() << endl;
+        Close(); return(false);
+    }   // the sites must end before the offset table
+
+    // the restriction enzymes of the catalogue, in the order of the sites of a record
+    vector<string> catalogue; const char* name = reinterpret_cast<const char*>(pMapped + header.enzyme_offset);
+
+    for (int e = 0; e < nEnzymes; ++e)
+    {
+        size_t length = strnlen(name, reinterpret_cast<const char*>(pMapped + nMapped) - name);
+        catalogue.push_back(string(name, length)); name += length + 1;
+    }
+
+    const list<string>& enzymes = _cmd.EndonucleaseList(); BitVector bv;
+    stENZYME enzyme; int left;
+
+    for (list<string>::const_iterator i = enzymes.begin(); !(i == enzymes.end()); ++i)
+    {
+        enzyme.slot = find(catalogue.begin(), catalogue.end(), *i) - catalogue.begin();
+
+        if (!(enzyme.slot < nEnzymes))
+        {
+            cout << "restriction enzyme is not in the site index: " << (*i) << endl;
+            Close(); return(false);
+        }   // every enzyme of the analysis must be in the index
+
+        bv.SetEndonuclease(*i);
+        enzyme.width = bv.GetLength();
+        enzyme.high = (bv.GetMaskWidth()) ? bv.GetMaskWidth() - 1 : 0;
+        bv.GetOffset(left, enzyme.offset);
+        vEnzyme.push_back(enzyme);
+    }   // the same settings as BitDigest::AddEnzyme()
+
+#ifdef _VERBOSE
+    cout << "site index: " << nRecords << " records, " << nEnzymes << " enzymes" << endl;
+#endif  // _VERBOSE
+
+    return(true);
+#endif  // _WIN32
+}   // end of Open()
+
+/*
+ * release the mapping
+*/
+void SiteIndex::Close()
+{
+#ifndef _WIN32
+    if (pMapped)
+    {
+        munmap(const_cast<unsigned char*>(pMapped), nMapped);
+    }   // the index is mapped for this job alone
+#endif  // _WIN32
+
+    pMapped = 0; nMapped = 0; pTable = 0;
+    nRecords = 0; nEnzymes = 0; vEnzyme.clear();
+}   // end of Close()
+
+/*
+ * the restriction sites of the enzymes of the analysis between _offset and _offset +
+ * _length of the record, with the same outcome as BitDigest::Digest(). returns false if
+ * the record is not in the index
+*/
+bool SiteIndex::Digest(
+    size_t              _record,    // number of the record in the database
+    int                 _offset,    // first base of the amplicon
+    int                 _length,    // number of bases in the amplicon
+    vector<stDIGEST>&   _site)     // restriction sites of each enzyme
+    const
+{
+    if (!(_record < nRecords))
+    {
+        return(false);
+    }   // the record is not in the index
+
+    const unsigned char* sites = pMapped + (pTable[_record] & ~uWideSITES);
+
+    if (pTable[_record] & uWideSITES)
+    {
+        Clip(reinterpret_cast<const uint32_t*>(sites), _offset, _length, _site);
+    }
+    else
+    {
+        Clip(reinterpret_cast<const uint16_t*>(sites), _offset, _length, _site);
+    }   // most records take 16 bits for each number
+
+    return(true);
+}   // end of Digest()
+
+/*
+ * find the sites of each enzyme that lie within the amplicon. the sites are sorted, so
+ * the first one is located with a binary search; the sites never overlap, so the search
+ * for the next site resumes right after the last one
+*/
+template <class T> void SiteIndex::Clip(
+    const T*            _sites,     // sites of the record
+    int                 _offset,    // first base of the amplicon
+    int                 _length,    // number of bases in the amplicon
+    vector<stDIGEST>&   _site)     // restriction sites of each enzyme
+    const
+{
+    const T* list = _sites + nEnzymes + 1; const T *s, *last;
+    stDIGEST none = { 0, 0, 0 };
+    int first, end;
+
+    _site.assign(vEnzyme.size(), none);
+
+    for (unsigned int i = 0; i < vEnzyme.size(); ++i)
+    {
+        const stENZYME& enzyme = vEnzyme[i]; stDIGEST& cut = _site[i];
+        s = list + _sites[enzyme.slot]; last = list + _sites[enzyme.slot + 1];
+
+        for (first = 0; !((s = lower_bound(s, last, _offset + first)) == last) &&
+            !(static_cast<int>(*s) - _offset > _length - enzyme.width); )
+        {
+            end = static_cast<int>(*s) - _offset + enzyme.width;
+            cut.first = (cut.count > 0) ? cut.first : end - enzyme.offset;
+            cut.last = end - enzyme.offset; ++cut.count;
+            first = end + enzyme.high - enzyme.width + 1;
+        }   // the sites within the amplicon, without overlaps
+    }   // every enzyme of the analysis
+}   // end of Clip()
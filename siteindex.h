@@ -0,0 +1,107 @@
+/*
+ * SITEINDEX.H
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * this is the header file for the index of the restriction sites of a database
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#ifndef _SITEINDEX_H
+#define _SITEINDEX_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "cmdparam.h"
+#include "bitvector.h"
+
+using namespace std;
+
+const char szSiteMAGIC[8] = { 'M', 'I', 'C', 'A', 'S', 'I', 'T', '1' };
+
+/*
+ * layout of the site index written by mkindex; all numbers are stored in the byte order
+ * of the host. the header is followed by the sites of every record in database order,
+ * the offset table with one entry per record and one more for the end of the sites, and
+ * the restriction enzymes of the catalogue, each terminated with a null. the sites of a
+ * record start with the number of sites before each enzyme of the catalogue, and one
+ * more for the total, followed by the first base of every site, enzyme by enzyme in the
+ * order of the catalogue. the numbers of a record take 16 bits each if they fit, which
+ * holds for all but the longest sequences; otherwise 32 bits, and the offset of the
+ * record is marked with uWideSITES
+*/
+const uint64_t uWideSITES = static_cast<uint64_t>(1) << 63;
+
+typedef struct
+{
+    char magic[8];              // szSiteMAGIC
+    uint64_t size;              // size of the database in bytes
+    uint64_t inode;             // inode of the database
+    int64_t mtime;              // modification time of the database in nanoseconds
+    uint64_t records;           // number of records in the database
+    uint64_t enzymes;           // number of restriction enzymes in the catalogue
+    uint64_t table_offset;      // offset table; records + 1 entries
+    uint64_t enzyme_offset;     // restriction enzymes of the catalogue
+} stSITEHEADER;
+
+/*
+ * class implementation of the restriction site index. the sites of every enzyme of the
+ * catalogue are found once for the whole database by mkindex; a digest then looks up
+ * the sites that fall within the amplicon with binary searches, instead of scanning
+ * the bases of the amplicon. the index is named by site_index in the parameter file and
+ * is only used if it has been built from the same database and holds all the enzymes
+ * of the analysis; otherwise the amplicons are scanned as before
+*/
+class   SiteIndex
+{
+public:
+    SiteIndex() : pMapped(0), nMapped(0), nRecords(0), nEnzymes(0) {};
+    ~SiteIndex() { Close(); }
+
+    bool Open(CmdParam&);       // map the index and find the enzymes of the analysis
+    void Close();               // release the mapping
+    bool IsOpen() const         { return(pMapped != 0); }
+
+    bool Digest(size_t, int, int, vector<stDIGEST>&) const;
+
+private:
+    template <class T> void Clip(const T*, int, int, vector<stDIGEST>&) const;
+
+    typedef struct
+    {
+        int slot;               // enzyme of the catalogue
+        int width;              // number of bases in the restriction site
+        int high;               // highest bit of the mask; sets the next site that may start
+        int offset;             // number of bases from the cut to the end of the site
+    } stENZYME;
+
+    const unsigned char* pMapped;   // the whole index
+    size_t nMapped;             // size of the mapping
+    const uint64_t* pTable;     // offset of the sites of each record
+    size_t nRecords;            // number of records in the index
+    int nEnzymes;               // number of enzymes in the catalogue
+    vector<stENZYME> vEnzyme;   // enzymes of the analysis, in the order of the parameters
+};  // end of class definition for SiteIndex
+
+#endif  // _SITEINDEX_H
@@ -0,0 +1,152 @@
+/*
+ * THREADPOOL.CPP
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#include <threadpool.h>
+#include <thread>
+
+// for debugging purpose
+//#define _VERBOSE
+
+#ifdef _VERBOSE
+#include <iostream>
+#endif  // _VERBOSE
+
+/*
+ * class constructor; start the worker threads
+*/
+ThreadPool::ThreadPool(
+    int _threads) : nActive(0), bStop(false)
+{
+    pthread_mutex_init(&mtxLock, NULL);
+    pthread_cond_init(&cvTask, NULL);
+    pthread_cond_init(&cvDone, NULL);
+    vtWorker.assign((_threads > 0) ? _threads : Concurrency(), 0);
+
+#ifdef _VERBOSE
+    cout << "number of threads: " << vtWorker.size() << endl;
+#endif  // _VERBOSE
+
+    for (unsigned int i = 0; i < vtWorker.size(); ++i)
+    {
+        pthread_create(&vtWorker[i], NULL, &ThreadPool::Work, this);
+    }   // the workers sleep until a task is submitted
+}   // end of class constructor
+
+/*
+ * class destructor; finish the waiting tasks and stop the worker threads
+*/
+ThreadPool::~ThreadPool()
+{
+    pthread_mutex_lock(&mtxLock);
+    bStop = true; pthread_cond_broadcast(&cvTask);
+    pthread_mutex_unlock(&mtxLock);
+
+    for (unsigned int i = 0; i < vtWorker.size(); ++i)
+    {
+        pthread_join(vtWorker[i], NULL);
+    }   // wait for all threads to complete
+
+    pthread_cond_destroy(&cvDone);
+    pthread_cond_destroy(&cvTask);
+    pthread_mutex_destroy(&mtxLock);
+}   // end of class destructor
+
+/*
+ * number of processors available; falls back to a single thread if it is unknown
+*/
+int ThreadPool::Concurrency()
+{
+    int cores = static_cast<int>(thread::hardware_concurrency());
+    return((cores > 0) ? cores : 1);
+}   // end of Concurrency()
+
+/*
+ * queue a task for the next idle worker
+*/
+void ThreadPool::Submit(
+    void*   (*_routine)(void*),     // function to run
+    void*   _argument)             // argument passed to the function
+{
+    stTASK task = { _routine, _argument };
+
+    pthread_mutex_lock(&mtxLock);
+    lsTask.push_back(task); pthread_cond_signal(&cvTask);
+    pthread_mutex_unlock(&mtxLock);
+}   // end of Submit()
+
+/*
+ * block until the task list is empty and no task is running
+*/
+void ThreadPool::Wait()
+{
+    pthread_mutex_lock(&mtxLock);
+
+    while (!lsTask.empty() || (nActive > 0))
+    {
+        pthread_cond_wait(&cvDone, &mtxLock);
+    }   // the last worker to finish wakes up the caller
+
+    pthread_mutex_unlock(&mtxLock);
+}   // end of Wait()
+
+/*
+ * main loop of the worker threads; take the tasks one at a time until the pool stops
+*/
+void* ThreadPool::Work(
+    void* _pool)
+{
+    ThreadPool* pool = static_cast<ThreadPool*>(_pool); stTASK task;
+
+    pthread_mutex_lock(&pool->mtxLock);
+
+    for (;;)
+    {
+        while (pool->lsTask.empty() && !pool->bStop)
+        {
+            pthread_cond_wait(&pool->cvTask, &pool->mtxLock);
+        }   // sleep until there is something to do
+
+        if (pool->lsTask.empty())
+        {
+            break;
+        }   // the pool is stopping and all tasks are done
+
+        task = pool->lsTask.front(); pool->lsTask.pop_front(); ++pool->nActive;
+        pthread_mutex_unlock(&pool->mtxLock);
+
+        task.routine(task.argument);    // run the task outside the lock
+
+        pthread_mutex_lock(&pool->mtxLock);
+
+        if (!(--pool->nActive > 0) && pool->lsTask.empty())
+        {
+            pthread_cond_broadcast(&pool->cvDone);
+        }   // the pool is idle
+    }   // keep running the tasks
+
+    pthread_mutex_unlock(&pool->mtxLock);
+    return(NULL);
+}   // end of Work()
@@ -0,0 +1,74 @@
+/*
+ * THREADPOOL.H
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * this is the header file for the pool of worker threads shared by all tools
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <list>
+#include <vector>
+#include <pthread.h>
+
+using namespace std;
+
+/*
+ * class implementation of a fixed pool of worker threads; the threads are created once
+ * and run the submitted tasks in the order of submission until the pool is destroyed.
+ * a task has the same signature as the start routine of pthread_create()
+*/
+class   ThreadPool
+{
+public:
+    ThreadPool(int = 0);        // number of threads; 0 uses all available processors
+    ~ThreadPool();
+
+    void Submit(void* (*)(void*), void* = 0);
+    void Wait();                // block until all submitted tasks have completed
+    int GetThreads() const      { return(vtWorker.size()); }
+
+    static int Concurrency();   // number of processors available to the process
+
+private:
+    typedef struct
+    {
+        void* (*routine)(void*);    // function to run
+        void* argument;             // argument passed to the function
+    } stTASK;
+
+    vector<pthread_t> vtWorker;
+    list<stTASK> lsTask;        // tasks waiting for a worker
+    int nActive;                // tasks that are currently running
+    bool bStop;
+
+    pthread_mutex_t mtxLock;    // protects the task list and the counters
+    pthread_cond_t cvTask;      // signals the workers that a task is waiting
+    pthread_cond_t cvDone;      // signals Wait() that the pool is idle
+
+    static void* Work(void*);   // main loop of the worker threads
+};  // end of class definition for ThreadPool
+
+#endif  // _THREADPOOL_H
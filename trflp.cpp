@@ -37,12 +37,12 @@
 // support class implementation
 #include "trflp.h"
 #include "pthread.h"
+#include "seqscan.h"
+#include "ampcache.h"
 
 // force PHP to return immediately
 #define CLOSE_PHP       { fclose(stdin); fclose(stdout); fclose(stderr); };
 
-const unsigned int nMaxTHREAD = 4;
-
 /*
  * sort by the species abundance in ascending order
 */
@@ -127,9 +127,9 @@ bool SortReverseD(
 */
 bool WriteDAT(
     list<stNICHE>&  _niche,     // plausible community profile based on trflp data
-    CmdParam&       _cmd)      // command-line parameters
+    const string&   _name)     // output filename without an extension
 {
-    string name = _cmd.GetFilename();
+    string name = _name;
     name += ".dat";         // add an extension
     ofstream ofs(name.c_str(), ios::trunc);
     char buffer[nMaxBUFFER];
@@ -167,9 +167,10 @@ bool WriteDAT(
 */
 bool WriteTXT(
     list<stNICHE>&  _niche,     // fragment data storage
-    CmdParam&       _cmd)      // command-line parameters
+    CmdParam&       _cmd,       // command-line parameters
+    const string&   _name)     // output filename without an extension
 {
-    string name = _cmd.GetFilename();
+    string name = _name;
     name += ".txt";             // add an extension
     ofstream ofs(name.c_str(), ios::trunc);
     char buffer[nMaxBUFFER];
@@ -216,9 +217,10 @@ bool WriteTXT(
 */
 bool WriteCSV(
     list<stNICHE>& _niche,      // fragment data storage
-    CmdParam&      _cmd)       // command-line parameters
+    CmdParam&      _cmd,        // command-line parameters
+    const string&  _name)      // output filename without an extension
 {
-    string name = _cmd.GetFilename();
+    string name = _name;
     name += ".csv";             // add an extension
     ofstream ofs(name.c_str(), ios::trunc);
     char buffer[nMaxBUFFER];
@@ -255,9 +257,9 @@ bool WriteCSV(
  * draw the output in PHP format for web display
 */
 bool WritePHP(
-    CmdParam& _cmd)    // command-line parameters
+    const string& _name)    // output filename without an extension
 {
-    string name = _cmd.GetFilename();
+    string name = _name;
     name += ".php";             // add and extension
     ofstream ofs(name.c_str(), ios::trunc);
 
@@ -269,94 +271,150 @@ bool WritePHP(
     ofs << "<?php" << endl;
     ofs << "  require \"shared.data.inc\";" << endl;
     ofs << "  DrawHeader(\"MiCA: T-RFLP Analysis (APLAUS+) Output\");" << endl;
-    ofs << "  DrawTRFLP(" << _cmd.GetFilename() << ");" << endl;
+    ofs << "  DrawTRFLP(" << _name << ");" << endl;
     ofs << "  DrawFooter();" << endl << "?>" << endl;
     ofs.close(); return(true);
 }   // end of WritePHP()
 
-// globally accessible classes for multithreading
-CmdParam cmd; SeqDB rdp;
-list<stNICHE> niche;
-pthread_mutex_t mtxLock;    // critical region lock for database
+/*
+ * a t-rflp analysis; everything the analysis needs is kept in the job, so that several
+ * jobs can share a single scan of the database
+*/
+typedef struct
+{
+    CmdParam cmd;                       // parameters of the job
+    AmpliconCache cache;                // amplicons of the primer pair, if cached
+    SiteIndex index;                    // restriction sites of the database, if indexed
+    SeedIndex seeds;                    // primer seeds of the database, if indexed
+    tRFLP* rflp;                        // adds up the fragment counts of the workers
+    list<tRFLP> worker;                 // one instance for each worker
+    vector< list<stNICHE> > niche;      // community profile of each sample
+    pthread_mutex_t mtxLock;            // critical region lock for the job
+} stJOB;
 
 /*
- * the prodcution trflp function
+ * read the parameter file and set up the job
 */
-void* DoTRFLP(void*)
+void* OpenJob(
+    const char* _param)    // parameter file
 {
-    int forward, reverse; stNICHE item; bool run = false;
+    stJOB* job = new stJOB;
 
-    pthread_mutex_lock(&mtxLock);
-    // ** enter the critical section for records
-    tRFLP rflp(cmd);
-    // ** leave the critical section for database
-    pthread_mutex_unlock(&mtxLock);
+    if (!job->cmd.OpenFile(_param))
+    {
+        delete job; return(0);
+    }   // open the parameter file; every primer must fit into the bit streams
+
+    job->cache.Open(job->cmd);          // skip the primer search if the amplicons are known
+    job->index.Open(job->cmd);          // look up the restriction sites if they are indexed
 
-    do
+    if (!job->cache.IsCached())
     {
-        pthread_mutex_lock(&mtxLock);
-        // ** enter the critical section for database
-        run = rdp.NextRecord();     // retrive a sequence from the database
+        job->seeds.Open(job->cmd);
+    }   // look up the windows of the primers if the amplicons are not known
 
-        if (run)
-        {
-            rflp.SetStrand(rdp.GetOrigin());
-            item.organism = rdp.GetOrganism();
-        }   // set the sequence for the search
-        // ** leave the critical section for database
-        pthread_mutex_unlock(&mtxLock);
+    job->rflp = new tRFLP(job->cmd);
+    job->niche.assign(job->rflp->SampleCount(), list<stNICHE>());
+    pthread_mutex_init(&job->mtxLock, NULL);     // initialize the lock for the job
+    return(job);
+}   // end of OpenJob()
+
+/*
+ * parameters of the job
+*/
+CmdParam& JobParam(
+    void* _job)
+{
+    return(static_cast<stJOB*>(_job)->cmd);
+}   // end of JobParam()
+
+/*
+ * the class of a worker is owned by the job, which adds up the fragment counts of all
+ * workers once they are finished
+*/
+void* StartWorker(
+    void* _job)
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+
+    pthread_mutex_lock(&job.mtxLock);
+    // ** enter the critical section for the job
+    job.worker.emplace_back(job.cmd); tRFLP* rflp = &job.worker.back();
+    // ** leave the critical section for the job
+    pthread_mutex_unlock(&job.mtxLock);
+
+    return(rflp);
+}   // end of StartWorker()
 
-        if (!run || !rflp.Delimit())
+/*
+ * the prodcution trflp function; every record is digested once and matched against
+ * all samples
+*/
+void ScanBatch(
+    void*       _job,       // the job
+    void*       _rflp,      // class of the worker
+    stBATCH*    _batch)    // records to be analyzed
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+    tRFLP& rflp = *static_cast<tRFLP*>(_rflp);
+    int forward, reverse; stNICHE item;
+    vector< list<stNICHE> > found(rflp.SampleCount());
+
+    vector<stAMPLICON> amplicon;        // outcomes of the primer search, for the cache
+
+    for (int n = 0; n < _batch->count; ++n)
+    {
+        stSEQUENCE& seq = _batch->records[n];
+
+        if (!job.cache.Delimit(rflp, seq, _batch->first + n, amplicon, &job.seeds))
         {
             continue;
-        }   // skip if there is no more sequences or amplification fails
+        }   // skip if amplification fails
 
-        rflp.Digest(forward, reverse);    // perform restriction digest
+        item.organism = seq.organism;
+
+        rflp.Digest(forward, reverse, &job.index, _batch->first + n);    // perform restriction digest
         item.fpredict = static_cast<double>(forward),
         item.rpredict = static_cast<double>(reverse);
 
-        if (!rflp.MatchSample(item))
-        {   
-            continue;
-        }   // both fragments must match to be included in the list
+        for (int k = 0; k < rflp.SampleCount(); ++k)
+        {
+            if (rflp.MatchSample(item, k))
+            {
+                found[k].push_back(item);
+            }   // both fragments must match to be included in the list
+        }   // match the fragments against every sample
+    }   // process every record of the batch
 
-        pthread_mutex_lock(&mtxLock);
-        // ** enter the critical section for records
-        niche.push_back(item);
-        // ** leave the critical section for database
-        pthread_mutex_unlock(&mtxLock);
-    } while (run);
+    job.cache.Store(_batch->first, amplicon);
 
-    return(NULL);
-}   // end of DoTRFLP()
+    pthread_mutex_lock(&job.mtxLock);
+    // ** enter the critical section for records
+    for (int k = 0; k < rflp.SampleCount(); ++k)
+    {
+        job.niche[k].splice(job.niche[k].end(), found[k]);
+    }   // move the matches of the batch to the community profiles
+    // ** leave the critical section for records
+    pthread_mutex_unlock(&job.mtxLock);
+}   // end of ScanBatch()
 
 /*
- * to compile, type:
- * g++ cmdparam.cpp seqdb.cpp bitvector.cpp trflp.cpp -o trflp.exe
+ * nothing to merge; the fragment counts are added up when the job is closed
 */
-int main(int argc, char** argv)
+void StopWorker(
+    void*, void*)
 {
-    if (argc < 2) {
-        cout << "insufficient number of parameters" << endl;
-        return(1);
-    }
+}   // end of StopWorker()
 
-    cmd.OpenFile(argv[1]);                  // open the parameter file
-    rdp.OpenFile(cmd.GetDatabase());        // open the sequence database
-    niche.clear();
-
-    pthread_mutex_init(&mtxLock, NULL);     // initialize the lock for database
-    vector<pthread_t> pts(nMaxTHREAD, 0);   // a vector for pthread
-
-    for (unsigned int i = 0; i < pts.size(); ++i)
-    {
-        pthread_create(&pts[i], NULL, &DoTRFLP, NULL);
-    }   // first, spawn the threads
-
-    for (unsigned int j = 0; j < pts.size(); ++j)
-    {
-        pthread_join(pts[j], NULL);
-    }   // wait for all threads to complete
+/*
+ * calculate the abundances and write the outputs of every sample; returns false if an
+ * output cannot be written
+*/
+bool CloseJob(
+    void* _job)
+{
+    stJOB& job = *static_cast<stJOB*>(_job);
+    tRFLP& rflp = *job.rflp;
 
     bool (*SortOption[8])(const stNICHE&, const stNICHE&) =
     {
@@ -370,18 +428,80 @@ int main(int argc, char** argv)
         SortOrganismD   // sort by the species name is descending order
     };  // nasty function pointers
 
-    tRFLP rflp(cmd);
-    rflp.SetAbundance(niche);     // calculate the relative abundance
-    niche.sort(SortOption[cmd.SortOption()]);
+    for (list<tRFLP>::iterator w = job.worker.begin(); !(w == job.worker.end()); ++w)
+    {
+        rflp.AddCount(*w);
+    }   // add up the fragment counts of every worker
+
+    bool written = true;
+
+    for (int k = 0; k < rflp.SampleCount(); ++k)
+    {
+        string name = job.cmd.GetFilename();
 
-    /*
-     * write the output in various formats; explicitly signal the compiler that these
-     * funcation calls do not require any specific order. the compiler is free to
-     * rearrange for processor dispatch and parallel processing.
-    */
-    WriteCSV(niche, cmd), WriteTXT(niche, cmd), WritePHP(cmd), WriteDAT(niche, cmd);
+        if (rflp.SampleCount() > 1)
+        {
+            name += "_" + to_string(k + 1);
+        }   // in batch mode, the output of each sample is numbered in the listed order
+
+        rflp.SetAbundance(job.niche[k], k);   // calculate the relative abundance
+        job.niche[k].sort(SortOption[job.cmd.SortOption()]);
+
+        /*
+         * write the output in various formats; explicitly signal the compiler that these
+         * funcation calls do not require any specific order. the compiler is free to
+         * rearrange for processor dispatch and parallel processing.
+        */
+        written &= WriteCSV(job.niche[k], job.cmd, name) & WriteTXT(job.niche[k], job.cmd, name) &
+            WritePHP(name) & WriteDAT(job.niche[k], name);
+    }   // write a separate set of outputs for every sample
+
+    job.cache.Close();                  // keep the amplicons for the next run
+    job.index.Close();                  // release the site index
+    job.seeds.Close();                  // release the seed index
+    pthread_mutex_destroy(&job.mtxLock);
+    delete job.rflp; delete &job;
+    return(written);
+}   // end of CloseJob()
+
+// the hooks of the analysis into the database scan
+const stANALYSIS stAnalysis =
+{
+    "trflp", OpenJob, JobParam, StartWorker, ScanBatch, StopWorker, CloseJob
+};
+
+/*
+ * to compile, type:
+ * g++ -std=c++17 -O3 -I. bitvector.cpp cmdparam.cpp seqdb.cpp threadpool.cpp seqqueue.cpp
+ *     seqscan.cpp ampcache.cpp siteindex.cpp seedindex.cpp trflp.cpp -o trflp -lpthread
+*/
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        cout << "insufficient number of parameters" << endl;
+        return(1);
+    }
+
+    void* job = OpenJob(argv[1]);       // open the parameter file
+
+    if (!job)
+    {
+        return(1);
+    }   // the parameter file cannot be used
+
+    CmdParam& cmd = JobParam(job);
+
+    if (argc > 2)
+    {
+        cmd.SetThreads(atoi(argv[2]));
+    }   // the number of threads on the command line overrides the parameter file
+
+    bool scanned = ScanDatabase(cmd.GetDatabase(), cmd.Threads(), vector<stQUERY>(1, { &stAnalysis, job }));
+
+    if (!CloseJob(job) || !scanned)
+    {
+        return(1);
+    }   // the database cannot be read, or an output cannot be written
 
-    pthread_exit(NULL);
-    pthread_mutex_destroy(&mtxLock);
     return(0);
 }   // end of main()
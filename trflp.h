@@ -41,11 +41,13 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <algorithm>
 
 // class implementations
 #include "seqdb.h"
 #include "cmdparam.h"
 #include "bitvector.h"
+#include "siteindex.h"
 
 // for debugging purpose
 //#define _VERBOSE
@@ -63,6 +65,15 @@ typedef struct
     unsigned int count;     // number of fragments that has been matched
 } stSAMPLE;
 
+/*
+ * order the sample fragments by size
+*/
+inline bool SortSample(
+    const stSAMPLE& _a, const stSAMPLE& _b)
+{
+    return(_a.fragment < _b.fragment);
+}   // end of SortSample()
+
 /*
  * this structure establishes a relational model to associate the sample fragments
  * with the predicted fragments
@@ -75,8 +86,8 @@ typedef struct
     double fpredict;        // matched, predicted forward fragment
     double rpredict;        // matched, predicted reverse fragment
     double biomass;         // normalized, relative abundance
-    list<stSAMPLE>::iterator findex;
-    list<stSAMPLE>::iterator rindex;
+    int findex;             // index to the forward fragment in the sample profile
+    int rindex;             // index to the reverse fragment in the sample profile
 } stNICHE;
 
 /*
@@ -88,27 +99,36 @@ public:
     tRFLP(CmdParam&);
     ~tRFLP() {};
 
-    bool SetStrand(const string&);
-    bool Delimit();                         // delimit sequences with two primers
-    bool Digest(int&, int&);              // cut sequences with restriction enzymes
-    bool MatchSample(stNICHE&);           // match the predicted and observed fragments
-    bool SetAbundance(list<stNICHE>&);    // calculate the relative abundance of species
+    bool SetStrand(string_view, const BitLane* = 0);
+    bool Delimit(stDELIMIT&);             // delimit sequences with two primers
+    bool SetAmplicon(const stDELIMIT&);   // delimit with an amplicon found before
+    bool Delimit()      { stDELIMIT range; return(Delimit(range)); }
+    bool Digest(int&, int&, const SiteIndex* = 0, size_t = 0);    // cut sequences with restriction enzymes
+    bool MatchSample(stNICHE&, int = 0);        // match the predicted and observed fragments
+    bool SetAbundance(list<stNICHE>&, int = 0); // calculate the relative abundance of species
+    void AddCount(const tRFLP&);                // add the fragment counts of another instance
+    int SampleCount() const     { return(vForwardSample.size()); }
 
     void PrintStrand() const    { cout << szStrand; }
 
 private:
     int nForwardIndex, nReverseIndex, nEnzymeIndex;
     bool bForwardFound, bReverseFound;
+    const BitLane* pLane;       // bit lanes of the sequence, or 0 to roll the bit streams
+    int nAmplicon;              // offset of the amplicon in the bit lanes
+    vector<stDIGEST> vSite;     // restriction sites found in the site index
     double dForwardBin, dReverseBin;
 
     // binary representations for the primers and restriction enzymes
     BitVector bvForwardPrimer, bvReversePrimer, bvEndonuclease;
     BitVector bvForwardStrand, bvReverseStrand, bvEnzymeStrand;
-    list<stSAMPLE> lsForwardSample, lsReverseSample;
+    // one profile for each sample, sorted by the fragment size
+    vector< vector<stSAMPLE> > vForwardSample, vReverseSample;
 
-    string szStrand;
+    string_view szStrand;       // view of the record, narrowed to the amplicon
 
-    bool LoadSample(list<stSAMPLE>&, const char*);
+    bool LoadSample(vector<stSAMPLE>&, const char*);
+    int FindSample(const vector<stSAMPLE>&, double, double) const;
 };  // end of class definition tRFLP
 
 /*
@@ -136,18 +156,26 @@ tRFLP::tRFLP(
     cout << "reverse window size: " << dReverseBin << endl;
 #endif  // _VERBOSE
 
-    // load the observed fragments into memory
-    LoadSample(lsForwardSample, _cmd.GetForwardSample());
-    LoadSample(lsReverseSample, _cmd.GetReverseSample());
+    // load the observed fragments of every sample into memory
+    int samples = max(1, _cmd.ForwardSampleCount());
+    vForwardSample.resize(samples); vReverseSample.resize(samples);
+
+    for (int i = 0; i < samples; ++i)
+    {
+        LoadSample(vForwardSample[i], _cmd.GetForwardSample(i));
+        LoadSample(vReverseSample[i], _cmd.GetReverseSample(i));
+    }   // the forward and reverse profiles are paired in the order they are listed
 }   // end of contructor
 
 /*
  * set the sequence to be searched
 */
 bool tRFLP::SetStrand(
-    const string& _s)
+    string_view     _s,         // sequence to be searched
+    const BitLane*  _lane)     // bit lanes of the sequence, if available
 {
-    szStrand = _s;
+    szStrand = _s; nAmplicon = 0;
+    pLane = (_lane && (_lane->GetLength() == static_cast<int>(_s.length()))) ? _lane : 0;
 
     if (!(szStrand.length() > 0))
     {
@@ -158,6 +186,11 @@ bool tRFLP::SetStrand(
     cout << "szStrand: " << szStrand << endl;
 #endif
 
+    if (pLane)
+    {
+        return(true);
+    }   // the bit lanes are searched directly
+
     // convert primers and sequence into bit streams for search
     bvForwardStrand.SetForwardStrand(bvForwardPrimer.GetLength(), szStrand);
     bvReverseStrand.SetReverseStrand(bvReversePrimer.GetLength(), szStrand);
@@ -173,12 +206,28 @@ bool tRFLP::SetStrand(
 }   // end of SetStrand()
 
 /*
- * restrict the sequences with two primers
+ * restrict the sequences with two primers; the outcome is kept in _range, so that it
+ * can be given to SetAmplicon() later
 */
-bool tRFLP::Delimit()
+bool tRFLP::Delimit(
+    stDELIMIT& _range)     // positions of the primers and the amplicon
 {
     bForwardFound = bReverseFound = false;
 
+    if (pLane)
+    {
+        bool found = pLane->Delimit(bvForwardPrimer, bvReversePrimer, _range);
+        bForwardFound = _range.bForward; bReverseFound = _range.bReverse;
+
+        if (found)
+        {
+            szStrand = szStrand.substr(_range.begin, _range.end - _range.begin + 1);
+            nAmplicon = _range.begin;
+        }   // same outcome as the interleaved search below
+
+        return(found);
+    }   // search the bit lanes of the sequence, 64 positions at a time
+
     while (nForwardIndex < nReverseIndex)
     {
         if (!bForwardFound)
@@ -196,6 +245,11 @@ bool tRFLP::Delimit()
         if (bForwardFound && bReverseFound)
         {
             // pointer will one step further even though a match has been found
+            _range.forward = bvForwardStrand.GetDistance() - 1;
+            _range.reverse = bvReverseStrand.GetDistance() - 1;
+            _range.begin = nForwardIndex; _range.end = nReverseIndex;
+            _range.bForward = _range.bReverse = true;
+            nAmplicon = nForwardIndex;
             szStrand = szStrand.substr(nForwardIndex, nReverseIndex - nForwardIndex + 1);
 
 #ifdef _VERBOSE         // print out some crucial variables
@@ -210,37 +264,77 @@ bool tRFLP::Delimit()
 }   // end of Delimit()
 
 /*
- * cut the sequence with the restriction enzyme(s)
+ * delimit the sequence with an amplicon that Delimit() has found before, such as one
+ * taken from the amplicon cache; the outcome is the same as that of the search. the
+ * amplicon must lie within the sequence
+*/
+bool tRFLP::SetAmplicon(
+    const stDELIMIT& _range)   // positions of the primers and the amplicon
+{
+    bForwardFound = _range.bForward; bReverseFound = _range.bReverse;
+    szStrand = szStrand.substr(_range.begin, _range.end - _range.begin + 1);
+    nAmplicon = _range.begin;
+    return(true);
+}   // end of SetAmplicon()
+
+/*
+ * cut the sequence with the restriction enzyme(s); with a site index, the sites are
+ * looked up in the index instead of searched for in the amplicon
 */
 bool tRFLP::Digest(
-    int&    _forward,   // predicted forward fragment
-    int&    _reverse)  // predicted reverse fragment
+    int&                _forward,   // predicted forward fragment
+    int&                _reverse,   // predicted reverse fragment
+    const SiteIndex*    _index,     // restriction sites of the database, if any
+    size_t              _record)   // number of the record in the database
 {
     int size; int prior = 0;
     int full = bvForwardPrimer.GetLength() + bvReversePrimer.GetLength() + szStrand.length();
-    bvEnzymeStrand.SetDigestStrand(bvEndonuclease.GetLength(), szStrand);
-    nEnzymeIndex = bvEndonuclease.GetLength() - 1;      // index starts from 0
     vector<int> trf; trf.clear();       // empty the fragment list
 
-    // now, search for the restriction enzymes
-    while (nEnzymeIndex < static_cast<int>(szStrand.length()))
+    if (_index && _index->IsOpen() && _index->Digest(_record, nAmplicon, szStrand.length(), vSite))
+    {
+        if (vSite[0].count > 0)
+        {
+            trf.push_back(vSite[0].first); prior = vSite[0].last;
+        }   // only the first and the last cuts shape the terminal fragments
+    }
+    else if (pLane)
     {
-        if (bvEndonuclease.IsEnzyme(bvEnzymeStrand))    // found enzyme
+        for (int next = 0; (next = bvEndonuclease.FindEnzyme(*pLane, nAmplicon,
+            szStrand.length(), next)) > 0; )
         {
-            // calculate the digested fragment sizes
-            size = bvEnzymeStrand.GetDistance() - bvEndonuclease.GetOffset() - prior;
-            trf.push_back(size);          // save the digested fragment size
-            bvEnzymeStrand.Clear();         // reset the bitvector for the next search
-            prior += size;
+            size = next - bvEndonuclease.GetOffset() - prior;
+            trf.push_back(size); prior += size;
+        }   // search the bit lanes of the amplicon, 64 positions at a time
+    }
+    else
+    {
+        bvEnzymeStrand.SetDigestStrand(bvEndonuclease.GetLength(), szStrand);
+        nEnzymeIndex = bvEndonuclease.GetLength() - 1;      // index starts from 0
+
+        // now, search for the restriction enzymes
+        while (nEnzymeIndex < static_cast<int>(szStrand.length()))
+        {
+            if (bvEndonuclease.IsEnzyme(bvEnzymeStrand))    // found enzyme
+            {
+                // calculate the digested fragment sizes
+                size = bvEnzymeStrand.GetDistance() - bvEndonuclease.GetOffset() - prior;
+                trf.push_back(size);          // save the digested fragment size
+                bvEnzymeStrand.Clear();         // reset the bitvector for the next search
+                prior += size;
 
 #ifdef _VERBOSE
-            cout << "prior: " << prior << endl;
-            cout << " size: " << size << endl;
+                cout << "prior: " << prior << endl;
+                cout << " size: " << size << endl;
 #endif  // _VERBOSE
-        }
+            }
 
-        bvEnzymeStrand.AddNucleotide(szStrand[++nEnzymeIndex]);
-    }
+            if (++nEnzymeIndex < static_cast<int>(szStrand.length()))
+            {
+                bvEnzymeStrand.AddNucleotide(szStrand[nEnzymeIndex]);
+            }   // the view ends at the amplicon; no terminating null to roll in
+        }
+    }   // roll the bit streams one nucleotide at a time
 
     if (trf.empty())
     {
@@ -259,50 +353,69 @@ bool tRFLP::Digest(
     return(true);         // everything has worked as expected
 }   // end of Digest()
 
+/*
+ * find the sample fragment nearest to the predicted fragment; since the samples are
+ * sorted, only the two fragments around the prediction need to be compared. ties go
+ * to the smaller fragment, and equal fragments to the first one in the sample file.
+ * returns -1 if no fragment is within the window
+*/
+int tRFLP::FindSample(
+    const vector<stSAMPLE>& _sample,    // sample fragments sorted by size
+    double  _predict,                   // predicted fragment size
+    double  _bin) const                // window size
+{
+    stSAMPLE key; key.fragment = _predict;
+    vector<stSAMPLE>::const_iterator i = lower_bound(_sample.begin(), _sample.end(), key, SortSample);
+    double nearest = _bin; int index = -1;
+
+    if (!(i == _sample.end()) && !((*i).fragment - _predict > _bin))
+    {
+        nearest = (*i).fragment - _predict; index = i - _sample.begin();
+    }   // the smallest fragment that is not below the prediction
+
+    if (!(i == _sample.begin()) && !(_predict - (*(i - 1)).fragment > nearest))
+    {
+        key.fragment = (*(i - 1)).fragment;
+        index = lower_bound(_sample.begin(), i, key, SortSample) - _sample.begin();
+    }   // the largest fragment below the prediction, if it is as close
+
+    return(index);
+}   // end of FindSample()
+
 /*
  * match the predicted fragments to the observed fragments in the sample file
 */
 bool tRFLP::MatchSample(
-    stNICHE&    _niche)    // predicted community profile
+    stNICHE&    _niche,     // predicted community profile
+    int         _sample)   // which sample?
 {
-    if (lsForwardSample.empty() || lsReverseSample.empty())
+    vector<stSAMPLE>& forward = vForwardSample[_sample];
+    vector<stSAMPLE>& reverse = vReverseSample[_sample];
+
+    if (forward.empty() || reverse.empty())
     {
         return(false);
     }   // make sure both lists are not empty before matching proceeds
 
-    bool is_forward = false;
-    bool is_reverse = false;
-    list<stSAMPLE>::iterator f, r;
+    int f = FindSample(forward, _niche.fpredict, dForwardBin);
+    int r = FindSample(reverse, _niche.rpredict, dReverseBin);
 
-    for (f = lsForwardSample.begin(); !(f == lsForwardSample.end()); ++f)
+    if ((f < 0) || (r < 0))
     {
-        if (!(fabs((*f).fragment - _niche.fpredict) > dForwardBin))
-        {
-            _niche.fobserve = (*f).fragment, _niche.findex = f, is_forward = true;
-            break;
-        }   // forward fragment size is within the boundary
-    }   // first, match the forward fragments
+        return(false);
+    }   // both fragments must be within the boundary
 
-    for (r = lsReverseSample.begin(); !(r == lsReverseSample.end()); ++r)
-    {
-        if (!(fabs((*r).fragment - _niche.rpredict) > dReverseBin))
-        {
-            _niche.robserve = (*r).fragment, _niche.rindex = r, is_reverse = true;
-            break;
-        }   // reverse fragment size is within the boundary
-    }   // then, match the reverse fragment
+    _niche.fobserve = forward[f].fragment, _niche.findex = f;
+    _niche.robserve = reverse[r].fragment, _niche.rindex = r;
+    forward[f].count++, reverse[r].count++;
 
-    if (is_forward && is_reverse)
-    {
-        (*f).count++, (*r).count++;
 #ifdef _VERBOSE
-        cout << "predicted and observed fragments are a match" << endl;
-        cout << "(" << _niche.fpredict << ", " << _niche.fobserve << ") ";
-        cout << "(" << _niche.rpredict << ", " << _niche.robserve << ")" << endl;
+    cout << "predicted and observed fragments are a match" << endl;
+    cout << "(" << _niche.fpredict << ", " << _niche.fobserve << ") ";
+    cout << "(" << _niche.rpredict << ", " << _niche.robserve << ")" << endl;
 #endif  // _VERBOSE
-    }   // if both fragments are a match, update the counter
 
-    return(is_forward && is_reverse);
+    return(true);
 }   // end of MatchSample()
 
 /*
@@ -310,7 +423,7 @@ bool tRFLP::MatchSample(
  * separated value (csv) format
 */
 bool tRFLP::LoadSample(
-    list<stSAMPLE>& _sample,    // structure of the fragments in the sample
+    vector<stSAMPLE>& _sample,  // structure of the fragments in the sample
     const char* _name)         // name of the sample file
 {
     ifstream ifs(_name, ios::in);
@@ -346,36 +459,68 @@ bool tRFLP::LoadSample(
 #endif  // _VERBOSE
     }   // read the file line by line until eof is encountered
 
+    // sort by the fragment size, keeping the file order among equal fragments
+    stable_sort(_sample.begin(), _sample.end(), SortSample);
+
     ifs.close(); return(true);
 }   // end of LoadSample()
 
+/*
+ * add the fragment counts of another instance that has loaded the same sample files;
+ * every worker counts its own matches, and the counts are added up once all of them
+ * are finished, so that no lock is needed while matching
+*/
+void tRFLP::AddCount(
+    const tRFLP&    _rflp)     // instance of a worker
+{
+    for (size_t k = 0; (k < vForwardSample.size()) && (k < _rflp.vForwardSample.size()); ++k)
+    {
+        vector<stSAMPLE>& forward = vForwardSample[k];
+        vector<stSAMPLE>& reverse = vReverseSample[k];
+
+        for (size_t i = 0; (i < forward.size()) && (i < _rflp.vForwardSample[k].size()); ++i)
+        {
+            forward[i].count += _rflp.vForwardSample[k][i].count;
+        }   // add the counts of the forward fragments
+
+        for (size_t i = 0; (i < reverse.size()) && (i < _rflp.vReverseSample[k].size()); ++i)
+        {
+            reverse[i].count += _rflp.vReverseSample[k][i].count;
+        }   // add the counts of the reverse fragments
+    }   // every sample is counted separately
+}   // end of AddCount()
+
 /*
  * calculate assign the normalized relative abundance to each species in the community
 */
 bool tRFLP::SetAbundance(
-    list<stNICHE>& _niche)
+    list<stNICHE>&  _niche,     // predicted community profile of the sample
+    int             _sample)   // which sample?
 {
+    vector<stSAMPLE>& forward = vForwardSample[_sample];
+    vector<stSAMPLE>& reverse = vReverseSample[_sample];
+
     if (_niche.empty())
     {
         return(false);
     }   // make sure the list is not empty
 
-    list<stSAMPLE>::iterator i; list<stNICHE>::iterator j;
+    vector<stSAMPLE>::iterator i; list<stNICHE>::iterator j;
     double abundance = 0.0;
 
-    for (i = lsForwardSample.begin(); !(i == lsForwardSample.end()); ++i)
+    for (i = forward.begin(); !(i == forward.end()); ++i)
     {
         (*i).biomass /= ((*i).count == 0) ? 1.0 : static_cast<double>((*i).count);
     }   // normalize the abundance for the forward fragments in the sample
 
-    for (i = lsReverseSample.begin(); !(i == lsReverseSample.end()); ++i)
+    for (i = reverse.begin(); !(i == reverse.end()); ++i)
     {
         (*i).biomass /= ((*i).count == 0) ? 1.0 : static_cast<double>((*i).count);
     }   // normalize the abundance for the reverse fragments in the sample
 
     for (j = _niche.begin(); !(j == _niche.end()); ++j)
     {
-        (*j).biomass = (*(*j).findex).biomass + (*(*j).rindex).biomass;
+        (*j).biomass = forward[(*j).findex].biomass + reverse[(*j).rindex].biomass;
         abundance += (*j).biomass;        // accumulate the abundance
     }   // assign the normalized abundance to the predicted community profile
 
@@ -0,0 +1,198 @@
+/*
+ * TXT2BIN.CPP
+ *
+ * Written by Conrad Shyu (conradshyu at hotmail.com)
+ *
+ * Initiative for Bioinformatics and Evolutionary Studies (IBEST)
+ * Department of Bioinformatics and Computational Biology (BCB)
+ * Department of Biological Sciences
+ * University of Idaho, Moscow, ID 83844
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * this program converts the plain text database into the packed binary format; the
+ * sequences are stored with 2 bits per base, which cuts the size of the database to
+ * about a quarter and lets the analysis tools map it straight into memory
+ *
+ * All rights reserved. Copyright (R) 2026.
+ * last updated on October 18, 2026
+*/
+#include <seqdb.h>
+
+/*
+ * append the bytes of an object to the end of a section
+*/
+template <class T> void Append(
+    vector<char>& _section, const T* _data, size_t _count = 1)
+{
+    const char* data = reinterpret_cast<const char*>(_data);
+    _section.insert(_section.end(), data, data + sizeof(T) * _count);
+}   // end of Append()
+
+/*
+ * pack a sequence with 2 bits per base; anything other than A, C, G, or T, including
+ * lower case bases, is written as A and recorded in the exception runs instead, so that
+ * the original sequence is restored exactly
+*/
+void Pack(
+    string_view                 _origin,    // sequence to pack
+    vector<unsigned char>&      _packed,    // packed sequence
+    vector<stBINEXCEPTION>&     _runs)     // runs of the bases that cannot be packed
+{
+    stBINEXCEPTION run; unsigned char code;
+
+    _packed.assign((_origin.length() + 3) / 4, 0);
+    memset(&run, 0, sizeof(stBINEXCEPTION));
+
+    for (size_t i = 0; i < _origin.length(); ++i)
+    {
+        switch (_origin[i])
+        {
+            case 'A': code = 0; break;
+            case 'C': code = 1; break;
+            case 'G': code = 2; break;
+            case 'T': code = 3; break;
+            default:  code = 4; break;
+        }   // encode the base
+
+        if (code < 4)
+        {
+            _packed[i / 4] |= code << (6 - 2 * (i % 4)); continue;
+        }   // the base can be packed
+
+        if ((run.length > 0) && (run.base == _origin[i]) &&
+            (run.position + run.length == i) && (run.length < 65535))
+        {
+            ++run.length; continue;
+        }   // extend the current run
+
+        if (run.length > 0)
+        {
+            _runs.push_back(run);
+        }   // save the previous run
+
+        run.position = static_cast<uint32_t>(i); run.length = 1; run.base = _origin[i];
+    }   // process the entire sequence
+
+    if (run.length > 0)
+    {
+        _runs.push_back(run);
+    }   // save the last run
+}   // end of Pack()
+
+/*
+ * pad a section with zeros up to the next multiple of 8 bytes
+*/
+void Align(
+    ofstream& _out, uint64_t& _offset)
+{
+    static const char zero[8] = { 0 };
+    size_t pad = (8 - _offset % 8) % 8;
+
+    _out.write(zero, pad); _offset += pad;
+}   // end of Align()
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        cout << "usage: " << argv[0] << " input.txt output.bin" << endl;
+        return(1);
+    }   // make sure the input and output files are specified
+
+    SeqDB rdp;
+
+    if (!rdp.MapFile(argv[1]) && !rdp.OpenFile(argv[1]))
+    {
+        return(1);
+    }   // map the sequence database; otherwise, read it as a stream
+
+    if (rdp.IsBinary())
+    {
+        cout << "database is already in binary format: " << argv[1] << endl;
+        return(1);
+    }   // nothing to convert
+
+    ofstream out(argv[2], ios::out | ios::binary | ios::trunc);
+
+    if (!out.is_open())
+    {
+        cout << "cannot create binary database: " << argv[2] << endl;
+        return(1);
+    }   // make sure the output file can be created
+
+    stSEQUENCE seq; stBINHEADER header; stBINENTRY entry;
+    vector<unsigned char> packed; vector<stBINEXCEPTION> runs, exceptions;
+    vector<char> heap; vector<stBINENTRY> table;
+    uint64_t offset = sizeof(stBINHEADER);
+
+    memset(&header, 0, sizeof(stBINHEADER));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(stBINHEADER));
+
+    while (rdp.NextRecord(seq))
+    {
+        if ((seq.origin.length() > UINT32_MAX) || (seq.organism.length() > UINT32_MAX) ||
+            (seq.accession.length() > UINT32_MAX) || (seq.locus.length() > UINT32_MAX))
+        {
+            cout << "record is too long to convert: " << seq.accession << endl;
+            return(1);
+        }   // the lengths are stored in 32 bits
+
+        runs.clear(); Pack(seq.origin, packed, runs);
+        memset(&entry, 0, sizeof(stBINENTRY));
+
+        entry.heap = heap.size();
+        entry.packed = offset;
+        entry.exception = exceptions.size();
+        entry.organism = static_cast<uint32_t>(seq.organism.length());
+        entry.accession = static_cast<uint32_t>(seq.accession.length());
+        entry.locus = static_cast<uint32_t>(seq.locus.length());
+        entry.origin = static_cast<uint32_t>(seq.origin.length());
+        entry.exceptions = static_cast<uint32_t>(runs.size());
+
+        Append(heap, seq.organism.data(), seq.organism.length());
+        Append(heap, seq.accession.data(), seq.accession.length());
+        Append(heap, seq.locus.data(), seq.locus.length());
+        exceptions.insert(exceptions.end(), runs.begin(), runs.end());
+        table.push_back(entry);
+
+        out.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+        offset += packed.size();
+    }   // the packed sequences are written as they are read
+
+    Align(out, offset); header.exception_offset = offset;
+    out.write(reinterpret_cast<const char*>(exceptions.data()),
+        exceptions.size() * sizeof(stBINEXCEPTION));
+    offset += exceptions.size() * sizeof(stBINEXCEPTION);
+
+    header.heap_offset = offset;
+    out.write(heap.data(), heap.size()); offset += heap.size();
+
+    Align(out, offset); header.table_offset = offset;
+    out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(stBINENTRY));
+
+    memcpy(header.magic, szBinaryMAGIC, sizeof(szBinaryMAGIC));
+    header.records = table.size();
+    out.seekp(0); out.write(reinterpret_cast<const char*>(&header), sizeof(stBINHEADER));
+    out.close();
+
+    if (out.fail())
+    {
+        cout << "cannot write binary database: " << argv[2] << endl;
+        return(1);
+    }   // make sure everything has been written
+
+    cout << "records: " << table.size() << ", exceptions: " << exceptions.size() << endl;
+    return(0);
+}   // end of main()